@@ -0,0 +1,495 @@
+/**
+* @file
+* @brief	Analytic pre-pass of the traces: figures & lower bounds of the runtime, without simulating.
+*
+* Goes over the event streams once they have been read and placed, and gets for each node its
+* computation cycles, packets sent & received and hop-packets (packets times the hops given by the
+* routing of the topology). With them, several lower bounds of the runtime are given, all of them
+* without contention:
+*
+* streams: a stream (thread) cannot run faster than its computation plus one cycle for each packet it sends.
+* ports: the packets of a node go through its injection ports and its consumption port, one phit per cycle.
+* links: all the hop-phits go through the links of the network, one phit per cycle each.
+* dependencies: the streams are replayed with the messages arriving as soon as possible (serialized at the
+* injection ports and one cycle per hop). Sends never wait for the receiver.
+*
+* The routing is not thread safe (some routings keep static state or use rand()), so the hops from each
+* node to the destinations of its packets are taken first, sequentially. Then the figures of the nodes are
+* taken by ANALYTIC_THREADS threads (with pthreads), which only read those hops. The dependencies are
+* replayed sequentially. The routing uses its own random state, so the simulation after the pre-pass is
+* the same as without it.
+* This file is only used when compiling with TRACE_SUPPORT != 0
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "globals.h"
+
+#if (TRACE_SUPPORT != 0)
+
+#if (ANALYTIC_THREADS != 0)
+#include <pthread.h>
+#endif
+
+/**
+* The figures of a node.
+*/
+typedef struct an_node {
+	double cpu;			///< Cycles computing (of all its streams).
+	double sent;		///< Packets sent.
+	double rcvd;		///< Packets received.
+	double hop_pkts;	///< Packets sent times the hops they travel.
+	double stream;		///< Cycles of its longest stream: computation plus one per packet sent.
+} an_node;
+
+/**
+* The hops from a node to the others, cached by a worker.
+*/
+typedef struct an_hops {
+	long *src;		///< Source of the cached hops to each destination, -1 if none.
+	long *val;		///< Cached hops to each destination.
+} an_hops;
+
+/**
+* A message sent but not received yet in the replay of the dependencies.
+*/
+typedef struct an_msg {
+	long from;			///< The node sending.
+	long task;			///< The tag.
+	long length;		///< The length in packets.
+	double arrival;		///< The cycle in which it arrives.
+	struct an_msg *next;	///< The next message to the same node.
+} an_msg;
+
+/**
+* A stream being replayed: the position in its events and in the loops being done.
+*/
+typedef struct an_stream {
+	long node;							///< The node of the stream.
+	event_n *pos[MAX_LOOP_DEPTH+1];		///< The next event in each loop level (0 is the stream).
+	long body[MAX_LOOP_DEPTH+1];		///< The loop body of each level.
+	double iters[MAX_LOOP_DEPTH+1];		///< Iterations left in each level.
+	long depth;							///< The innermost level.
+	double clock;						///< The cycle the stream has reached.
+	long next_waiting;					///< The next stream waiting a message in the same node, or -1.
+} an_stream;
+
+static an_node *an=NULL;	///< The figures of each node.
+static double factor;		///< Factor applied to the cpu bursts.
+static long *hop_first=NULL;	///< Position of the hops of each node in #hop_dst & #hop_val (nprocs+1 entries).
+static long *hop_dst=NULL;		///< The destinations of the packets of each node.
+static long *hop_val=NULL;		///< The hops to each of those destinations.
+static long n_hops, max_hops;	///< Entries used & allocated in #hop_dst & #hop_val.
+
+/**
+* Gets the hops from a node to another one, using the routing of the topology.
+*/
+static long an_hop(an_hops *h, long s, long d){
+	routing_r r;
+
+	if (s==d)
+		return 0;
+	if (h->src[d]!=s){
+		r=calc_rr(s, d);
+		h->src[d]=s;
+		h->val[d]=r.size;
+		free(r.rr);
+	}
+	return h->val[d];
+}
+
+/**
+* Takes the hops from a node to the destinations of a list of events (a stream or a loop body) not taken yet.
+*
+* @param h The cache of hops, where the destinations already taken have the node as source.
+* @param i The node.
+* @param n The first event.
+*/
+static void an_take_hops(an_hops *h, long i, event_n *n){
+	long d;
+
+	for (; n!=NULL; n=n->next)
+		switch (n->ev.type){
+			case SENDING:
+			case RDV_SENDING:
+			case RDV_ISENDING:
+				d=n->ev.pid;
+				if (d==i || h->src[d]==i)
+					break;
+				if (n_hops==max_hops){
+					max_hops=2*max_hops+1024;
+					if ((hop_dst=realloc(hop_dst, max_hops*sizeof(long)))==NULL ||
+						(hop_val=realloc(hop_val, max_hops*sizeof(long)))==NULL)
+						panic("Not enough memory for the hops of the analytic pre-pass");
+				}
+				hop_dst[n_hops]=d;
+				hop_val[n_hops++]=an_hop(h, i, d);
+				break;
+			case LOOP:
+				an_take_hops(h, i, trc_loop_body(n->ev.task));
+				break;
+			default:
+				break;
+		}
+}
+
+/**
+* Takes the hops from each node to the destinations of its packets, with the routing of the topology.
+*/
+static void an_take_all_hops(){
+	an_hops h;
+	long i, k;
+
+	h.src=alloc(nprocs*sizeof(long));
+	h.val=alloc(nprocs*sizeof(long));
+	for (i=0; i<nprocs; i++)
+		h.src[i]=-1;
+	hop_first=alloc((nprocs+1)*sizeof(long));
+	n_hops=max_hops=0;
+	for (i=0; i<nprocs; i++){
+		hop_first[i]=n_hops;
+		for (k=0; k<trc_streams(i); k++)
+			an_take_hops(&h, i, trc_stream(i, k));
+	}
+	hop_first[nprocs]=n_hops;
+	free(h.src);
+	free(h.val);
+}
+
+/**
+* Gets the cycles of a cpu burst.
+*/
+static double an_cpu(event *e){
+	return ceil((e->length-e->count)*factor);
+}
+
+/**
+* Adds the figures of a list of events (a stream or a loop body) to a node.
+*
+* @param h The cache of hops of the worker, with all the hops of the node already in it.
+* @param i The node.
+* @param n The first event.
+* @param mult The number of times the events are repeated (iterations of the enclosing loops).
+* @return The cycles of the events: computation plus one per packet sent.
+*/
+static double an_events(an_hops *h, long i, event_n *n, double mult){
+	double len=0.0, c;
+
+	for (; n!=NULL; n=n->next)
+		switch (n->ev.type){
+			case COMPUTATION:
+				c=mult*an_cpu(&n->ev);
+				an[i].cpu+=c;
+				len+=c;
+				break;
+			case SENDING:
+			case RDV_SENDING:
+			case RDV_ISENDING:
+				c=mult*n->ev.length;
+				an[i].sent+=c;
+				an[i].hop_pkts+=c*an_hop(h, i, n->ev.pid);
+				len+=c;
+				break;
+			case RECEPTION:
+				an[i].rcvd+=mult*n->ev.length;
+				break;
+			case LOOP:
+				len+=an_events(h, i, trc_loop_body(n->ev.task), mult*n->ev.length);
+				break;
+			default:
+				break;
+		}
+	return len;
+}
+
+/**
+* Gets the figures of the nodes w, w+ANALYTIC_THREADS, ...
+*/
+static void * an_worker(void *arg){
+	long w=(long)arg, i, k, t;
+	double len;
+	an_hops h;
+#if (ANALYTIC_THREADS != 0)
+	long step=ANALYTIC_THREADS;
+#else
+	long step=1;
+#endif
+
+	h.src=alloc(nprocs*sizeof(long));
+	h.val=alloc(nprocs*sizeof(long));
+	for (i=0; i<nprocs; i++)
+		h.src[i]=-1;
+	for (i=w; i<nprocs; i+=step){
+		for (k=hop_first[i]; k<hop_first[i+1]; k++){	// So the routing is not used in the threads.
+			h.src[hop_dst[k]]=i;
+			h.val[hop_dst[k]]=hop_val[k];
+		}
+		t=trc_streams(i);
+		for (k=0; k<t; k++){
+			len=an_events(&h, i, trc_stream(i, k), 1.0);
+			if (len>an[i].stream)
+				an[i].stream=len;
+		}
+	}
+	free(h.src);
+	free(h.val);
+	return NULL;
+}
+
+/**
+* Gets the next event of a stream being replayed, entering & leaving its loops.
+*
+* @return The event, or NULL if the stream has finished.
+*/
+static event * an_next(an_stream *s){
+	event_n *n;
+
+	for (;;){
+		while (s->pos[s->depth]==NULL){
+			if (s->depth==0)
+				return NULL;
+			if (--s->iters[s->depth]>0)
+				s->pos[s->depth]=trc_loop_body(s->body[s->depth]);
+			else
+				s->depth--;
+		}
+		n=s->pos[s->depth];
+		if (n->ev.type!=LOOP)
+			return &n->ev;
+		s->pos[s->depth]=n->next;
+		if (s->depth==MAX_LOOP_DEPTH)
+			panic("Too many nested loops for the analytic pre-pass");
+		s->depth++;
+		s->body[s->depth]=n->ev.task;
+		s->iters[s->depth]=n->ev.length;
+		s->pos[s->depth]=trc_loop_body(n->ev.task);
+	}
+}
+
+/**
+* Replays the streams with the messages arriving as soon as possible.
+*
+* A stream runs until it has to wait a message not sent yet; then it waits in its node until a message
+* for the node is sent.
+*
+* @param h A cache of hops.
+* @param blocked Returns the number of streams that cannot finish (the trace deadlocks).
+* @return The cycle in which the last stream finishes.
+*/
+static double an_dependencies(an_hops *h, long *blocked){
+	an_stream *st;
+	an_msg **inbox, **tail, *aux, *prev;
+	long *waiting, *ready;
+	long n_st=0, n_ready=0, i, k, p, done=0;
+	double end=0.0;
+	event *e;
+
+	for (i=0; i<nprocs; i++)
+		n_st+=trc_streams(i);
+	st=alloc(n_st*sizeof(an_stream));
+	ready=alloc(n_st*sizeof(long));
+	inbox=alloc(nprocs*sizeof(an_msg *));
+	tail=alloc(nprocs*sizeof(an_msg *));
+	waiting=alloc(nprocs*sizeof(long));
+	for (i=0, p=0; i<nprocs; i++){
+		inbox[i]=tail[i]=NULL;
+		waiting[i]=-1;
+		for (k=0; k<trc_streams(i); k++, p++){
+			st[p].node=i;
+			st[p].depth=0;
+			st[p].pos[0]=trc_stream(i, k);
+			st[p].clock=0.0;
+			ready[n_ready++]=p;
+		}
+	}
+
+	while (n_ready>0){
+		an_stream *s=&st[ready[--n_ready]];
+
+		while ((e=an_next(s))!=NULL){
+			switch (e->type){
+				case COMPUTATION:
+					s->clock+=an_cpu(e);
+					break;
+				case SENDING:
+				case RDV_SENDING:
+				case RDV_ISENDING:
+					aux=alloc(sizeof(an_msg));
+					aux->from=s->node;
+					aux->task=e->task;
+					aux->length=e->length;
+					aux->arrival=s->clock+ceil((double)e->length/ninj)*pkt_len+an_hop(h, s->node, e->pid);
+					aux->next=NULL;
+					if (tail[e->pid]==NULL)
+						inbox[e->pid]=aux;
+					else
+						tail[e->pid]->next=aux;
+					tail[e->pid]=aux;
+					s->clock+=e->length;
+					for (p=waiting[e->pid]; p>=0; p=st[p].next_waiting)	// They look for their message again.
+						ready[n_ready++]=p;
+					waiting[e->pid]=-1;
+					break;
+				case RECEPTION:
+					for (prev=NULL, aux=inbox[s->node]; aux!=NULL; prev=aux, aux=aux->next)
+						if (aux->from==e->pid && aux->task==e->task && aux->length==e->length)
+							break;
+					if (aux==NULL){
+						s->next_waiting=waiting[s->node];
+						waiting[s->node]=s-st;
+						goto next_stream;
+					}
+					if (aux->arrival>s->clock)
+						s->clock=aux->arrival;
+					if (prev==NULL)
+						inbox[s->node]=aux->next;
+					else
+						prev->next=aux->next;
+					if (tail[s->node]==aux)
+						tail[s->node]=prev;
+					free(aux);
+					break;
+				default:
+					break;
+			}
+			s->pos[s->depth]=s->pos[s->depth]->next;
+		}
+		done++;
+		if (s->clock>end)
+			end=s->clock;
+next_stream:
+		;
+	}
+
+	*blocked=n_st-done;
+	for (i=0; i<nprocs; i++)
+		while (inbox[i]!=NULL){
+			aux=inbox[i];
+			inbox[i]=aux->next;
+			free(aux);
+		}
+	free(st);
+	free(ready);
+	free(inbox);
+	free(tail);
+	free(waiting);
+	return end;
+}
+
+/**
+* Gets the number of links between routers (or routers & NICs) of the network.
+*/
+static long an_links(){
+	long i, p, l=0;
+
+	for (i=0; i<NUMNODES; i++)
+		for (p=0; p<radix; p++)
+			if (network[i].nbor[p]!=NULL_PORT)
+				l++;
+	return l;
+}
+
+/**
+* Runs the analytic pre-pass of the trace read and prints its figures & lower bounds.
+*/
+void analytic_prepass(){
+	struct timeval t0, t1;
+	char state[256];
+	char *old_state;
+	double tot_cpu=0.0, tot_sent=0.0, tot_rcvd=0.0, tot_hops=0.0, b_stream=0.0, b_ports=0.0, b_links, b_deps, b, c;
+	long i, n_str=0, blocked, m_cpu=0, m_stream=0, m_ports=0, links;
+	an_hops h;
+#if (ANALYTIC_THREADS != 0)
+	pthread_t th[ANALYTIC_THREADS];
+#endif
+
+	gettimeofday(&t0, NULL);
+	old_state=initstate((unsigned)r_seed, state, sizeof(state));	// The routing may be random.
+	factor=cpu_scale/((n_cpu_ratios>0)? cpu_ratios[0] : 1.0);
+	an=alloc(nprocs*sizeof(an_node));
+	for (i=0; i<nprocs; i++)
+		an[i].cpu=an[i].sent=an[i].rcvd=an[i].hop_pkts=an[i].stream=0.0;
+	an_take_all_hops();
+
+#if (ANALYTIC_THREADS != 0)
+	for (i=0; i<ANALYTIC_THREADS; i++)
+		if (pthread_create(&th[i], NULL, an_worker, (void *)i))
+			panic("Cannot create the analytic pre-pass threads");
+	for (i=0; i<ANALYTIC_THREADS; i++)
+		pthread_join(th[i], NULL);
+#else
+	an_worker((void *)0);
+#endif
+	free(hop_first);
+	free(hop_dst);
+	free(hop_val);
+	hop_first=hop_dst=hop_val=NULL;
+
+	for (i=0; i<nprocs; i++){
+		n_str+=trc_streams(i);
+		tot_cpu+=an[i].cpu;
+		tot_sent+=an[i].sent;
+		tot_rcvd+=an[i].rcvd;
+		tot_hops+=an[i].hop_pkts;
+		if (an[i].cpu>an[m_cpu].cpu)
+			m_cpu=i;
+		if (an[i].stream>b_stream){
+			b_stream=an[i].stream;
+			m_stream=i;
+		}
+		c=max(ceil(an[i].sent/ninj), an[i].rcvd)*pkt_len;
+		if (c>b_ports){
+			b_ports=c;
+			m_ports=i;
+		}
+	}
+	links=an_links();
+	b_links=(links>0)? ceil(tot_hops*pkt_len/links) : 0.0;
+
+	h.src=alloc(nprocs*sizeof(long));
+	h.val=alloc(nprocs*sizeof(long));
+	for (i=0; i<nprocs; i++)
+		h.src[i]=-1;
+	b_deps=an_dependencies(&h, &blocked);
+	free(h.src);
+	free(h.val);
+	setstate(old_state);
+
+	b=max(max(b_stream, b_ports), max(b_links, b_deps));
+	gettimeofday(&t1, NULL);
+
+	printf("\nAnalytic pre-pass of the trace (%ld nodes, %ld streams):\n", nprocs, n_str);
+	printf("Computation (cycles):              %.0f total, %.0f max (node %ld)\n", tot_cpu, an[m_cpu].cpu, m_cpu);
+	printf("Bytes sent/received:               %.0f / %.0f\n", tot_sent*pkt_len*phit_len, tot_rcvd*pkt_len*phit_len);
+	printf("Hop-bytes:                         %.0f (%.2f hops per packet)\n", tot_hops*pkt_len*phit_len,
+		(tot_sent>0)? tot_hops/tot_sent : 0.0);
+	printf("Bound by the streams (cycles):     %.0f (node %ld)\n", b_stream, m_stream);
+	printf("Bound by the ports (cycles):       %.0f (node %ld)\n", b_ports, m_ports);
+	printf("Bound by the links (cycles):       %.0f (%ld links)\n", b_links, links);
+	if (blocked>0)
+		printf("Bound by the dependencies:         none, %ld streams wait for messages never sent\n", blocked);
+	else
+		printf("Bound by the dependencies (cycles): %.0f\n", b_deps);
+	printf("Lower bound makespan (cycles):     %.0f\n", b);
+	printf("Pre-pass time (s):                 %.3f\n\n", (t1.tv_sec-t0.tv_sec)+(t1.tv_usec-t0.tv_usec)/1e6);
+	free(an);
+	an=NULL;
+}
+#endif /* TRACE_SUPPORT */
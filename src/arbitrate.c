@@ -38,16 +38,23 @@ static long ipr_l[2];
 port_type last_port_arb_con;
 
 /**
-* Initialization of the structures needed to perform arbitration.
+* Sets the thresholds of the in-transit priority from #intransit_pr.
 */
-void arbitrate_init(void) {
-	candidates = alloc(sizeof(bool_t) * n_ports);
+void set_intransit_priority(void) {
 	ipr_l[1] = (long) (intransit_pr * RAND_MAX);
 
 	if (timeout_upper_limit>0)
 		ipr_l[0] = 0;
 	else
 		ipr_l[0] = ipr_l[1];
+}
+
+/**
+* Initialization of the structures needed to perform arbitration.
+*/
+void arbitrate_init(void) {
+	candidates = alloc(sizeof(bool_t) * n_ports);
+	set_intransit_priority();
 
 	if (topo<DIRECT) // Direct Topologies.
 	    last_port_arb_con=p_inj_first;
@@ -39,6 +39,24 @@ double prev_latency;
  */
 static long convergence;
 
+/**
+* Phases of a batch simulation, to resume it from a checkpoint.
+*/
+#define PHASE_NONE 0			///< Not started.
+#define PHASE_WARM_UP 1			///< Fixed warm-up.
+#define PHASE_CONVERGENCY 2		///< Convergency assurement or MSER warm-up.
+#define PHASE_ADJUST 3			///< Waiting for the beginning of a batch.
+#define PHASE_STATIONARY 4		///< Taking batches.
+
+static long run_phase=PHASE_NONE;	///< The current phase.
+static bool_t converged;	///< Whether the warm-up finished because the system was in the stationary state.
+
+static long mser_n,		///< Number of complete MSER batches.
+	mser_obs,			///< Number of observations in the current MSER batch.
+	mser_max;			///< Maximum number of MSER batches.
+static double *mser_lat=NULL,	///< Average latency of each MSER batch.
+	*mser_acc=NULL;				///< Accepted load of each MSER batch.
+
 /**
 * Print the results of a batch in an Human Readable Style (not very dense).
 *
@@ -69,7 +87,11 @@ void print_batch_results_vast(batch_t *b){
 	printf("Phit     Inj.   Rcv.   Drop.:     %10lf %10lf %10lf\n", b->sent_phit_count, b->rcvd_phit_count, b->dropped_phit_count);
 	printf("Load     Prov.  Inj.   Acc.:      %10.5lf %10.5lf %10.5lf\n", load, b->inj_load, b->acc_load);
 	printf("Delay    Avg.   StDev. Max.:      %10.5lf %10.5lf %10ld\n", b->avg_delay, b->stDev_delay, b->max_delay);
-	printf("InjDelay Avg.   StDev. Max.:      %10.5lf %10.5lf %10ld\n\n",b->avg_inj_delay, b->stDev_inj_delay, b->max_inj_delay);
+	printf("InjDelay Avg.   StDev. Max.:      %10.5lf %10.5lf %10ld\n",b->avg_inj_delay, b->stDev_inj_delay, b->max_inj_delay);
+	printf("Delay    p50 p90 p99 p99.9:       %10.0lf %10.0lf %10.0lf %10.0lf\n",
+			b->pct_delay[0], b->pct_delay[1], b->pct_delay[2], b->pct_delay[3]);
+	printf("InjDelay p50 p90 p99 p99.9:       %10.0lf %10.0lf %10.0lf %10.0lf\n\n",
+			b->pct_inj_delay[0], b->pct_inj_delay[1], b->pct_inj_delay[2], b->pct_inj_delay[3]);
 }
 
 /**
@@ -101,11 +123,13 @@ void print_batch_results(batch_t *b){
 * packet sent count, received packet count, dropped packet count,
 * average delay, delay standard deviation, maximun delay,
 * average injection delay, injection delay standard deviation,
-* maximun injection delay.
+* maximun injection delay, delay & injection delay percentiles.
+* The latency histograms of the batch are added to the ones of the whole run.
 */
 void save_batch_results(){
 	CLOCK_TYPE copyclock;
 	double rcvd;
+	long i;
 	copyclock = sim_clock - last_reset_time; // time taken for this batch.
 
 	batch[reseted].clock = copyclock;
@@ -124,6 +148,12 @@ void save_batch_results(){
 	batch[reseted].avg_inj_delay = acum_inj_delay/rcvd;
 	batch[reseted].stDev_inj_delay = sqrt(fabs((acum_sq_inj_delay-(acum_inj_delay*acum_inj_delay)/rcvd)/(rcvd-1)));
 	batch[reseted].max_inj_delay = max_inj_delay;
+	for (i=0; i<N_PERCENTILES; i++){
+		batch[reseted].pct_delay[i] = hist_percentile(&delay_hist, percentiles[i]);
+		batch[reseted].pct_inj_delay[i] = hist_percentile(&inj_delay_hist, percentiles[i]);
+	}
+	hist_merge(&run_delay_hist, &delay_hist);
+	hist_merge(&run_inj_delay_hist, &inj_delay_hist);
 }
 
 /**
@@ -135,6 +165,7 @@ void save_batch_results(){
 * @see warm_up_period
 */
 void warm_up(void){
+	run_phase=PHASE_WARM_UP;
 	while (sim_clock < warm_up_period && !interrupted && !aborted){
 		data_movement(B_TRUE);
 		sim_clock++;
@@ -146,6 +177,7 @@ void warm_up(void){
 			global_q_u = global_q_u_current;
 			global_q_u_current = injected_count - rcvd_count - transit_dropped_count;
 		}
+		checkpoint_cycle();
 	}
 }
 
@@ -170,6 +202,52 @@ bool_t system_converges(void){
 	return (bool_t)(dif_load < threshold && dif_latency < threshold);
 }
 
+/**
+* Finishes the warm-up.
+*
+* Runs until the beginning of a batch, resets the stats & prints the reason of leaving the warm-up.
+*
+* @see converged
+*/
+static void end_warm_up(void){
+	run_phase=PHASE_ADJUST;
+	// Adjust for equal sample adquiring
+	while (sim_clock % batch_time != 0 && !interrupted  && !aborted){
+		data_movement(B_TRUE);
+		sim_clock++;
+		if ((pheaders > 0) && (sim_clock % pinterval == 0))
+			print_partials();
+
+		if (sim_clock % update_period == 0){
+			global_q_u = global_q_u_current;
+			global_q_u_current = injected_count - rcvd_count - transit_dropped_count;
+		}
+		checkpoint_cycle();
+	}
+	if (mser_lat != NULL){
+		free(mser_lat);
+		free(mser_acc);
+		mser_lat=mser_acc=NULL;
+	}
+	warmed_up = sim_clock;
+	reseted=-1;
+	reset_stats();
+
+    if (!interrupted && !aborted){
+        if (converged){
+            printf("\n ---------------------------------------------\n");
+            printf("                Warmed Up !!!!!!               \n");
+            printf(" ---------------------------------------------\n\n");
+        }
+        else{
+            printf("\n**********************************************\n");
+            printf("*        Convergency timeout reached.        *\n");
+            printf("*         Continue without converge!         *\n");
+            printf("**********************************************\n\n");
+        }
+    }
+}
+
 /**
 * The simulation continues to assure convergency.
 *
@@ -182,8 +260,11 @@ bool_t system_converges(void){
 * @see run_network_batch()
 */
 void convergency(void){
-	long converged=B_FALSE;
-	go_on=B_TRUE;
+	if (run_phase != PHASE_CONVERGENCY){
+		run_phase=PHASE_CONVERGENCY;
+		converged=B_FALSE;
+		go_on=B_TRUE;
+	}
 	while (go_on && !interrupted  && !aborted){
 		data_movement(B_TRUE);
 		sim_clock++;
@@ -209,37 +290,161 @@ void convergency(void){
 		}
 		if (sim_clock - warm_up_period >= max_conv_time)
 			go_on=B_FALSE;
+		checkpoint_cycle();
 	}
+}
 
-	// Adjust for equal sample adquiring
-	while (sim_clock % batch_time != 0 && !interrupted  && !aborted){
+/**
+* MSER truncation point of a series.
+*
+* Looks for the number of initial values whose removal minimizes the standard error of the mean of
+* the rest: sum((y[i]-mean)^2)/(n-d)^2 for i>=d. Only the first half of the series is considered.
+*
+* @param y The series.
+* @param n The length of the series.
+* @return The truncation point, n/2 if the series is not long enough to have left the transient.
+*/
+static long mser_point(double *y, long n){
+	double s=0.0, sq=0.0, m, se, best=-1.0;
+	long d, d_best=n/2;
+
+	for (d=n-1; d>=0; d--){
+		s+=y[d];
+		sq+=y[d]*y[d];
+		if (d>n/2)
+			continue;
+		m=s/(n-d);
+		se=fabs(sq-(n-d)*m*m)/((double)(n-d)*(n-d));
+		if (best<0.0 || se<=best){
+			best=se;
+			d_best=d;
+		}
+	}
+	return d_best;
+}
+
+/**
+* Allocates the series of the MSER warm-up.
+*
+* @param max The maximum number of MSER batches.
+*/
+static void mser_init(long max){
+	long k;
+
+	mser_n=0;
+	mser_obs=0;
+	mser_max=max;
+	mser_lat=alloc(mser_max*sizeof(double));
+	mser_acc=alloc(mser_max*sizeof(double));
+	for (k=0; k<mser_max; k++)
+		mser_lat[k]=mser_acc[k]=0.0;
+}
+
+/**
+* Warm-up with automatic truncation (MSER-5).
+*
+* Replaces the fixed warm-up & the convergency phase. Each #conv_period cycles the average latency
+* & the accepted load are taken, and the means of each #MSER_BATCH of these observations make the series.
+* The warm-up finishes as soon as the MSER truncation points of both series are within their first
+* halves, or after #warm_up_period + #max_conv_time cycles without finding them.
+*
+* @see mser_point()
+* @see run_network_batch()
+*/
+void mser_warm_up(void){
+	long d_lat, d_load;
+	double rcvd;
+
+	if (run_phase != PHASE_CONVERGENCY){
+		run_phase=PHASE_CONVERGENCY;
+		mser_init((warm_up_period+max_conv_time)/(conv_period*MSER_BATCH)+1);
+		converged=B_FALSE;
+		go_on=B_TRUE;
+		truncation=0;
+	}
+	while (go_on && !interrupted  && !aborted){
 		data_movement(B_TRUE);
 		sim_clock++;
 		if ((pheaders > 0) && (sim_clock % pinterval == 0))
 			print_partials();
-
+		if (sim_clock % conv_period == 0 ){
+			rcvd=rcvd_count - last_rcvd_count;
+			mser_lat[mser_n]+=(rcvd>0)? acum_delay/rcvd : 0.0;
+			mser_acc[mser_n]+=(double)(rcvd_phit_count)/(1.0 * nprocs * (sim_clock - last_reset_time));
+			reset_stats();
+			if (++mser_obs == MSER_BATCH){
+				mser_lat[mser_n]/=MSER_BATCH;
+				mser_acc[mser_n]/=MSER_BATCH;
+				mser_obs=0;
+				mser_n++;
+				if (mser_n >= MSER_MIN_BATCHES){
+					d_lat=mser_point(mser_lat, mser_n);
+					d_load=mser_point(mser_acc, mser_n);
+					if (d_lat < mser_n/2 && d_load < mser_n/2){
+						truncation=((d_lat>d_load)? d_lat : d_load)*conv_period*MSER_BATCH;
+						converged=B_TRUE;
+						go_on=B_FALSE;
+					}
+				}
+				if (mser_n == mser_max)
+					go_on=B_FALSE;
+			}
+		}
 		if (sim_clock % update_period == 0){
 			global_q_u = global_q_u_current;
 			global_q_u_current = injected_count - rcvd_count - transit_dropped_count;
 		}
+		if (sim_clock >= warm_up_period + max_conv_time)
+			go_on=B_FALSE;
+		checkpoint_cycle();
 	}
-	warmed_up = sim_clock;
-	reseted=-1;
-	reset_stats();
+	if (converged && !interrupted && !aborted)
+		printf("\nMSER-5 truncation point: %"PRINT_CLOCK" (after %"PRINT_CLOCK" cycles)\n", truncation, sim_clock);
+}
 
-    if (!interrupted && !aborted){
-        if (converged){
-            printf("\n ---------------------------------------------\n");
-            printf("                Warmed Up !!!!!!               \n");
-            printf(" ---------------------------------------------\n\n");
-        }
-        else{
-            printf("\n**********************************************\n");
-            printf("*        Convergency timeout reached.        *\n");
-            printf("*         Continue without converge!         *\n");
-            printf("**********************************************\n\n");
-        }
-    }
+/**
+* Relative half-width of the 95% confidence interval of the mean of some batch figures.
+*
+* Uses the Student's t quantile, approximated by the Cornish-Fisher expansion of the normal one.
+*
+* @param v The figure of each batch.
+* @param stride The distance, in bytes, between the figures of two consecutive batches.
+* @param n The number of batches.
+* @return The half-width divided by the mean.
+*/
+static double ci_rel_width(double *v, long stride, long n){
+	double z=1.959964, df=n-1, t, x, m=0.0, sq=0.0;
+	long i;
+
+	for (i=0; i<n; i++){
+		x=*(double*)((char*)v+i*stride);
+		m+=x;
+		sq+=x*x;
+	}
+	m/=n;
+	t=z+(z*z*z+z)/(4*df)+(5*pow(z,5)+16*z*z*z+3*z)/(96*df*df)+
+		(3*pow(z,7)+19*pow(z,5)+17*z*z*z-15*z)/(384*df*df*df);
+	if (m==0.0)
+		return 0.0;
+	return t*sqrt(fabs((sq-n*m*m)/df)/n)/fabs(m);
+}
+
+/**
+* Are the results precise enough?.
+*
+* Checks whether the confidence intervals of the average latency & the accepted load of the
+* batches taken are within #ci_precision of their means.
+*
+* @return TRUE if both figures are precise enough or FALSE in other case.
+*/
+static bool_t precise_enough(void){
+	double w_delay, w_load;
+
+	if (reseted < CI_MIN_SAMPLES)
+		return B_FALSE;
+	w_delay=ci_rel_width(&batch[0].avg_delay, sizeof(batch_t), reseted);
+	w_load=ci_rel_width(&batch[0].acc_load, sizeof(batch_t), reseted);
+	return (bool_t)(w_delay <= ci_precision && w_load <= ci_precision);
 }
 
 /**
@@ -247,11 +452,16 @@ void convergency(void){
 *
 * Continues the simulation for #samples batches of #batch_time cycles and at least
 * #min_batch_size packets received. Now is the time for capturing simulation stats.
+* When #ci_precision is set, it stops as soon as the results are precise enough.
 *
 * @see run_network_batch()
+* @see precise_enough()
 */
 void stationary(void){
-	go_on=B_TRUE;
+	if (run_phase != PHASE_STATIONARY){
+		run_phase=PHASE_STATIONARY;
+		go_on=B_TRUE;
+	}
 	while (go_on && !interrupted  && !aborted){
 		data_movement(B_TRUE);
 		sim_clock++;
@@ -271,7 +481,14 @@ void stationary(void){
 
 			if (reseted == samples)
 				go_on=B_FALSE;
+			else if (ci_precision > 0.0 && precise_enough()){
+				go_on=B_FALSE;
+				printf("\n ---------------------------------------------\n");
+				printf("          Precision reached: %3ld batches       \n", reseted);
+				printf(" ---------------------------------------------\n\n");
+			}
 		}
+		checkpoint_cycle();
 	}
 }
 
@@ -279,16 +496,64 @@ void stationary(void){
 * Run the simulation taking stats for some batches.
 *
 * The simulation are split in three phases:
-* Warm-up, Convergency assurement & Stationary state.
+* Warm-up, Convergency assurement & Stationary state. With the MSER warm-up mode
+* the first two are replaced by the automatic truncation. When restored from a checkpoint,
+* the simulation goes on from the phase in which the checkpoint was taken.
+* Once warmed up, the policy variants are forked, so they share the warm-up.
 *
 * @see warm_up()
 * @see convergency()
+* @see mser_warm_up()
 * @see stationary()
+* @see fork_variants()
 */
 void run_network_batch(void){
-	warm_up();
-	convergency();
+	if (run_phase < PHASE_ADJUST){
+		if (warm_up_mode == MSER_WARM_UP)
+			mser_warm_up();
+		else {
+			if (run_phase < PHASE_CONVERGENCY)
+				warm_up();
+			convergency();
+		}
+	}
+	if (run_phase < PHASE_STATIONARY){
+		end_warm_up();
+#ifndef WIN32
+		if (fork_file[0] != '\0')
+			fork_variants();
+#endif
+	}
 	stationary();
+#ifndef WIN32
+	if (fork_file[0] != '\0')
+		wait_variants();
+#endif
+}
+
+/**
+* Saves or restores the state of the batch simulation in a checkpoint.
+*
+* @see ckpt_data()
+*/
+void batch_checkpoint(void){
+	CKPT(run_phase);
+	CKPT(converged);
+	CKPT(convergence);
+	CKPT(cons_load);
+	CKPT(latency);
+	CKPT(prev_cons_load);
+	CKPT(prev_latency);
+	if (warm_up_mode == MSER_WARM_UP && run_phase == PHASE_CONVERGENCY){
+		CKPT(mser_max);
+		if (!ckpt_saving())
+			mser_init(mser_max);
+		CKPT(mser_n);
+		CKPT(mser_obs);
+		ckpt_data(mser_lat, mser_max*sizeof(double));
+		ckpt_data(mser_acc, mser_max*sizeof(double));
+	}
+	ckpt_data(batch, (samples+1)*sizeof(batch_t));
 }
 
 /**
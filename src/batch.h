@@ -21,6 +21,23 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #ifndef _batch
 #define _batch
 
+#define HIST_SUB (1<<HIST_SUB_BITS)	///< Sub-buckets of each power of two in the latency histograms.
+#define HIST_BUCKETS ((64-HIST_SUB_BITS+1)*HIST_SUB)	///< Buckets of the latency histograms.
+#define N_PERCENTILES 4	///< Percentiles reported: 50, 90, 99 & 99.9.
+#define N_SAT_FRACTIONS 4	///< Fractions of the saturation load measured: 25, 50, 75 & 90%.
+
+/**
+* Log-bucketed histogram of latencies (HDR style).
+*
+* Values under #HIST_SUB have a bucket each. Above, each power of two is split into #HIST_SUB
+* buckets, so the memory is bounded and recording a value takes constant time.
+*/
+typedef struct hist_t {
+	double count;					///< Values recorded.
+	CLOCK_TYPE max;					///< Maximum value recorded.
+	double bucket[HIST_BUCKETS];	///< Values recorded in each bucket.
+} hist_t;
+
 /**
 * Structure to contain information (statistics) of a sample.
 *
@@ -31,7 +48,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 * packet sent count, received packet count, dropped packet count,
 * average delay, delay standard deviation, maximun delay,
 * average injection delay, injection delay standard deviation,
-* maximun injection delay.
+* maximun injection delay, delay percentiles & injection delay percentiles.
 */
 typedef struct batch_t {
 	CLOCK_TYPE clock;					///< Cycles taken for this batch.
@@ -50,6 +67,8 @@ typedef struct batch_t {
 	double avg_inj_delay;		///< Averaged injection delay (time before entering in network).
 	double stDev_inj_delay;		///< Standard deviation of injection delay.
 	long max_inj_delay;			///< Maximum delay.
+	double pct_delay[N_PERCENTILES];		///< Percentiles of the delay.
+	double pct_inj_delay[N_PERCENTILES];	///< Percentiles of the injection delay.
 } batch_t;
 #endif
 
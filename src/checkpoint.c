@@ -0,0 +1,276 @@
+/**
+* @file
+* @brief	Checkpoint & restore of the state of a simulation.
+*
+* A checkpoint contains the routers (queues, arbitration & requesting state), the packets and
+* their free list, the state of the random number generator, the stats accumulators & the state
+* of the batch simulation, so a simulation restored from it goes on exactly as the original one.
+* The checkpoints are taken every #ckpt_period cycles and when the simulation is interrupted
+* (SIGINT or SIGTERM). They are written to a temporary file which is renamed when complete, so
+* an interruption while writing does not destroy the previous checkpoint.
+*
+* In trace driven simulations it also contains the state of the replay: the event queues and the
+* occurred events of the nodes, the tracking of their heads and the protocol, noise & kernel state.
+* The trace is read again when restoring, and its events are replaced by the saved ones.
+*
+* The configuration must be the same when restoring. Only the sizes of the structures are
+* checked, so the non structural options can be changed to reuse a warmed-up state.
+* Only available in batch simulations, and in trace driven ones without jobs, the critical path
+* or paraver output.
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "globals.h"
+
+#define CKPT_MAGIC "FSINCKP"	///< Mark at the beginning of the checkpoint files.
+#define CKPT_VERSION 2			///< Version of the checkpoint format.
+
+static FILE *ckf=NULL;			///< The checkpoint file being written or read.
+static bool_t saving;			///< Whether the checkpoint is being written (or read).
+static bool_t signal_ckpt=B_FALSE;	///< Whether the checkpoint after an interruption has been written.
+
+/**
+* Writes or reads some data of the checkpoint.
+*
+* Each part of the state is saved & restored by the same function, calling this one.
+*
+* @param p The data.
+* @param size The size of the data.
+*/
+void ckpt_data(void *p, size_t size){
+	if (size == 0)
+		return;
+	if ((saving)? fwrite(p, 1, size, ckf)!=size : fread(p, 1, size, ckf)!=size)
+		panic("Error in the checkpoint file");
+}
+
+/**
+* Is the checkpoint being written?.
+*
+* @return TRUE when writing, FALSE when restoring.
+*/
+bool_t ckpt_saving(void){
+	return saving;
+}
+
+/**
+* The sizes of the structures, which must be the same to restore a checkpoint.
+*/
+static void ckpt_header(void){
+	char magic[8]=CKPT_MAGIC;
+	long h[15]={CKPT_VERSION, NUMNODES, nprocs, n_ports, ninj, tr_ql, inj_ql, buffer_cap, pkt_max,
+			ndim, samples, plevel, sizeof(router), sizeof(packet_t), pattern==TRACE};
+	long r[15];
+
+	ckpt_data(magic, 8);
+	if (saving){
+		ckpt_data(h, sizeof(h));
+		return;
+	}
+	if (memcmp(magic, CKPT_MAGIC, 8))
+		panic("Not a checkpoint file");
+	ckpt_data(r, sizeof(r));
+	if (memcmp(h, r, sizeof(h)))
+		panic("The checkpoint does not match the configuration of this simulation");
+}
+
+/**
+* The routers: their queues, arbitration & requesting state.
+*/
+static void ckpt_network(void){
+	long i, j;
+	router *r;
+	port *p;
+
+	for (i=0; i<NUMNODES; i++){
+		r=&network[i];
+		CKPT(r->injecting_port);
+		CKPT(r->next_port);
+		CKPT(r->saved_packet);
+		if (!saving)
+			r->saved_packet.rr.rr=NULL;	// It is calculated when injected.
+		CKPT(r->pending_packet);
+		CKPT(r->triggered);
+#if (PCOUNT!=0 || ACTIVE_NODES!=0)
+		CKPT(r->pcount);
+#endif
+		CKPT(r->timeout_counter);
+		CKPT(r->timeout_packet);
+		CKPT(r->congested);
+		CKPT(r->source);
+		CKPT(r->traffic_seed);
+		CKPT(r->trigger_seed);
+		ckpt_data(r->op_i, radix*sizeof(long));
+		for (j=0; j<n_ports+1; j++){
+			p=&r->p[j];
+			CKPT(p->q.head);
+			CKPT(p->q.tail);
+			ckpt_data(p->q.pos, tr_ql*sizeof(phit));
+			CKPT(p->bet);
+			CKPT(p->aop);
+			CKPT(p->tor);
+			ckpt_data(p->req, n_ports*sizeof(CLOCK_TYPE));
+			CKPT(p->ri);
+			CKPT(p->sip);
+			ckpt_data(p->histo, (buffer_cap+1)*sizeof(CLOCK_TYPE));
+			CKPT(p->utilization);
+			CKPT(p->faulty);
+		}
+		if (i<nprocs)
+			for (j=0; j<ninj; j++){
+				CKPT(r->qi[j].head);
+				CKPT(r->qi[j].tail);
+				ckpt_data(r->qi[j].pos, inj_ql*sizeof(phit));
+			}
+	}
+}
+
+/**
+* The stats accumulators.
+*/
+static void ckpt_stats(void){
+	CKPT(sent_count);
+	CKPT(injected_count);
+	CKPT(rcvd_count);
+	CKPT(last_rcvd_count);
+	CKPT(dropped_count);
+	CKPT(transit_dropped_count);
+	CKPT(last_tran_drop_count);
+	CKPT(inj_phit_count);
+	CKPT(sent_phit_count);
+	CKPT(rcvd_phit_count);
+	CKPT(dropped_phit_count);
+	CKPT(acum_delay);
+	CKPT(acum_inj_delay);
+	CKPT(acum_sq_delay);
+	CKPT(acum_sq_inj_delay);
+	CKPT(max_delay);
+	CKPT(max_inj_delay);
+	CKPT(acum_hops);
+	CKPT(delay_hist);
+	CKPT(inj_delay_hist);
+	CKPT(run_delay_hist);
+	CKPT(run_inj_delay_hist);
+#if (BIMODAL_SUPPORT != 0)
+	CKPT(msg_sent_count);
+	CKPT(msg_injected_count);
+	CKPT(msg_rcvd_count);
+	CKPT(msg_acum_delay);
+	CKPT(msg_acum_inj_delay);
+	CKPT(msg_acum_sq_delay);
+	CKPT(msg_acum_sq_inj_delay);
+	CKPT(msg_max_delay);
+	CKPT(msg_max_inj_delay);
+#endif /* BIMODAL */
+	CKPT(global_q_u);
+	CKPT(global_q_u_current);
+	CKPT(reseted);
+	CKPT(last_reset_time);
+	CKPT(warmed_up);
+	CKPT(truncation);
+	CKPT(go_on);
+	ckpt_data(port_utilization, n_ports*sizeof(CLOCK_TYPE));
+	ckpt_data(source_ports, n_ports*sizeof(long));
+	ckpt_data(dest_ports, n_ports*sizeof(long));
+	if (plevel & 1){
+		tmap_checkpoint(&destinations);
+		tmap_checkpoint(&sources);
+	}
+	if (plevel & 4){
+		ckpt_data(inj_dst, max_dst*sizeof(long));
+		ckpt_data(con_dst, max_dst*sizeof(long));
+	}
+}
+
+/**
+* Saves or restores the whole state.
+*/
+static void ckpt_state(void){
+	char rng[sizeof(rng_state)];
+
+	ckpt_header();
+	CKPT(sim_clock);
+	setstate(rng_state);	// Stores the position of the generator in its state.
+	memcpy(rng, rng_state, sizeof(rng));
+	CKPT(rng);
+	if (!saving){	// setstate() stores the position in the state in use, so the read one is not set directly.
+		setstate(rng);
+		memcpy(rng_state, rng, sizeof(rng));
+		setstate(rng_state);
+	}
+	ckpt_network();
+	pkt_checkpoint();
+	ckpt_stats();
+	batch_checkpoint();
+#if (TRACE_SUPPORT != 0)
+	if (pattern == TRACE)
+		trc_checkpoint();
+#endif
+}
+
+/**
+* Writes a checkpoint to #ckpt_file.
+*/
+void write_checkpoint(void){
+	char tmp[140];
+
+	sprintf(tmp, "%s.tmp", ckpt_file);
+	if ((ckf=fopen(tmp, "wb"))==NULL)
+		panic("Cannot write the checkpoint file");
+	saving=B_TRUE;
+	ckpt_state();
+	if (fclose(ckf) || rename(tmp, ckpt_file))
+		panic("Cannot write the checkpoint file");
+	ckf=NULL;
+	printf("Checkpoint written at cycle %"PRINT_CLOCK"\n", sim_clock);
+}
+
+/**
+* Restores the simulation from #restore_file.
+*
+* Called once the network has been initialized.
+*/
+void read_checkpoint(void){
+	if ((ckf=fopen(restore_file, "rb"))==NULL)
+		panic("Cannot read the checkpoint file");
+	saving=B_FALSE;
+	ckpt_state();
+	fclose(ckf);
+	ckf=NULL;
+	printf("Restored from checkpoint at cycle %"PRINT_CLOCK"\n", sim_clock);
+}
+
+/**
+* Takes a checkpoint if it is time to.
+*
+* Called at the end of each simulated cycle. A checkpoint is taken every #ckpt_period cycles
+* and once the simulation is interrupted.
+*/
+void checkpoint_cycle(void){
+	if (ckpt_file[0] == '\0' || aborted)
+		return;
+	if (interrupted){
+		if (!signal_ckpt)
+			write_checkpoint();
+		signal_ckpt=B_TRUE;
+	}
+	else if (ckpt_period > 0 && sim_clock % ckpt_period == 0)
+		write_checkpoint();
+}
@@ -50,6 +50,77 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define SKIP_CPU_BURSTS 1 ///< If all the nodes are executing CPU events skip enough cycles until there is any communication event. Checking is somewhat compute intensive (although there is some space for improvement), so only should be used with cpu-intensive traces
 #endif /* CHECK_TRC_DEADLOCK */
 
+/**
+ * In trace driven simulation, visit only the nodes with some activity: phits in the router, a task sending, a finished cpu burst
+ * or a message arrived. Computing and waiting nodes cost nothing, so long cpu bursts overlapping sparse traffic are as fast as the traffic alone.
+ * It keeps the number of phits in each router, as PCOUNT does, but it does not need it to be active.
+ */
+#ifndef ACTIVE_NODES
+#define ACTIVE_NODES 1
+#endif /* ACTIVE_NODES */
+
+#if (TRACE_SUPPORT == 0)
+#undef ACTIVE_NODES
+#define ACTIVE_NODES 0
+#endif /* TRACE_SUPPORT */
+
+
+/**
+ * Number of annealing chains run in parallel (with pthreads) by the placement optimizer. 0 runs a single chain without threads.
+ */
+#ifndef PLACE_THREADS
+#define PLACE_THREADS 4
+#endif /* PLACE_THREADS */
+
+/**
+ * If non-zero, the paraver timeline is written to the file by a background thread (with pthreads).
+ */
+#ifndef PARAVER_THREAD
+#define PARAVER_THREAD 1
+#endif /* PARAVER_THREAD */
+
+/**
+ * Sub-buckets of each power of two in the latency histograms, as a power of two. The values are kept with
+ * a relative error below 2^-HIST_SUB_BITS.
+ */
+#ifndef HIST_SUB_BITS
+#define HIST_SUB_BITS 5
+#endif /* HIST_SUB_BITS */
+
+/**
+ * Minimum number of batches to estimate the confidence intervals when stopping by precision.
+ */
+#ifndef CI_MIN_SAMPLES
+#define CI_MIN_SAMPLES 5
+#endif /* CI_MIN_SAMPLES */
+
+/**
+ * Observations (of #conv_period cycles) averaged in each batch of the MSER warm-up detection (MSER-5).
+ */
+#ifndef MSER_BATCH
+#define MSER_BATCH 5
+#endif /* MSER_BATCH */
+
+/**
+ * Minimum number of MSER batches before looking for the truncation point.
+ */
+#ifndef MSER_MIN_BATCHES
+#define MSER_MIN_BATCHES 4
+#endif /* MSER_MIN_BATCHES */
+
+/**
+ * Maximum nesting of the loops in fsin trc files.
+ */
+#ifndef MAX_LOOP_DEPTH
+#define MAX_LOOP_DEPTH 32
+#endif /* MAX_LOOP_DEPTH */
+
+/**
+ * Number of threads (with pthreads) taking the figures of the nodes in the analytic pre-pass. 0 runs it without threads.
+ */
+#ifndef ANALYTIC_THREADS
+#define ANALYTIC_THREADS 4
+#endif /* ANALYTIC_THREADS */
 
 /* Execution driven simulation */
 #ifndef EXECUTION_DRIVEN
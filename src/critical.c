@@ -0,0 +1,480 @@
+/**
+* @file
+* @brief	Critical path and time breakdown of the tasks in trace driven simulation.
+*
+* The time of each task is split into computing, sending (including the cycles stalled because
+* the injection queue is full) and waiting for receptions, as its head event changes.
+*
+* The critical path is built as the simulation goes on. Each node keeps the breakdown of the
+* longest chain of dependencies leading to its current point. When a reception has to wait for its
+* message, the chain of the node is replaced by the chain of the sender when it finished sending the
+* message, plus the cycles the message spent in the network. At the end, the chain of the node that
+* finished last is the critical path of the application. The messages in it are kept, with the link in
+* which their packets waited most, to report the messages & links that dominate the run time.
+* The handshake of the rendezvous protocol is counted as sending time of the sender.
+* The states & messages are also passed to the paraver output, when it is written.
+* This file is only used when compiling with TRACE_SUPPORT != 0
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "globals.h"
+
+#if (TRACE_SUPPORT != 0)
+
+/**
+* The parts in which the time is split.
+*/
+typedef enum crit_part_t {
+	CP_COMPUTE = 0,	///< Computing.
+	CP_SEND,		///< Sending (including the stalls of the injection).
+	CP_RECV,		///< Waiting for a reception (in the task breakdown), or receiving a message which had already arrived (in the critical path).
+	CP_NETWORK,		///< Messages in the network (only in the critical path).
+	CP_STALL,		///< Injection stalled by a full injection queue (only in the task breakdown, included in CP_SEND).
+	CP_PARTS		///< Number of parts.
+} crit_part_t;
+
+/**
+* The messages looked for in the list of a node.
+*/
+typedef enum msg_find_t {
+	MSG_UNSENT,		///< The first message whose sent has not finished.
+	MSG_UNARRIVED,	///< The first message with packets still to arrive.
+	MSG_COMPLETE	///< The first message sent & arrived.
+} msg_find_t;
+
+/**
+* A message in the critical path of a node.
+*/
+typedef struct crit_rec {
+	long from;				///< Node sending the message.
+	long to;				///< Node receiving the message.
+	long task;				///< Tag of the message.
+	long length;			///< Length of the message, in packets.
+	CLOCK_TYPE net;			///< Cycles from the end of the sent to the arrival of the last packet.
+	long link_node;			///< Node of the link in which the packets of the message waited most, -1 if none.
+	long link_port;			///< Port of that link.
+	CLOCK_TYPE link_wait;	///< Cycles waited in that link.
+	long refs;				///< Number of chains & messages referring to this record.
+	struct crit_rec *prev;	///< The previous message in the chain.
+} crit_rec;
+
+/**
+* A chain of dependencies: the breakdown of its time and its last message.
+*/
+typedef struct crit_chain {
+	CLOCK_TYPE part[CP_PARTS];	///< Cycles in each part.
+	crit_rec *last;				///< Last message in the chain, NULL if none.
+} crit_chain;
+
+/**
+* A message on its way to a node.
+*/
+typedef struct crit_msg {
+	long from;				///< Node sending the message.
+	long task;				///< Tag of the message.
+	long length;			///< Length of the message, in packets.
+	bool_t sent;			///< The sender has finished it, so #chain & #sent_time are set.
+	crit_chain chain;		///< The chain of the sender when it finished sending the message.
+	CLOCK_TYPE start_time;	///< Cycle in which the sender started the message.
+	CLOCK_TYPE sent_time;	///< Cycle in which the sender finished the message.
+	long arrived;			///< Number of packets arrived.
+	CLOCK_TYPE arr_time;	///< Cycle in which the last packet arrived.
+	long link_node;			///< Node of the link in which the packets waited most, -1 if none.
+	long link_port;			///< Port of that link.
+	CLOCK_TYPE link_wait;	///< Cycles waited in that link.
+	struct crit_msg *next;	///< Next message to the same node.
+} crit_msg;
+
+/**
+* The critical path state of a node.
+*/
+typedef struct crit_node {
+	crit_chain chain;			///< Longest chain of dependencies up to #mark.
+	CLOCK_TYPE mark;			///< Cycle in which the head event of the node started.
+	CLOCK_TYPE own[CP_PARTS];	///< The time breakdown of the node itself.
+	CLOCK_TYPE stall_start;		///< Cycle in which the injection got stalled, -1 if it is not stalled.
+	CLOCK_TYPE end;				///< Cycle in which the node finished its events.
+	crit_msg *msgs;				///< Messages on their way to this node.
+} crit_node;
+
+/**
+* A link, with the time the messages of the critical path waited in it.
+*/
+typedef struct crit_link {
+	long node;			///< The node of the link.
+	long port;			///< The output port of the link.
+	CLOCK_TYPE wait;	///< Cycles waited in the link.
+	long msgs;			///< Number of messages whose worst link is this.
+} crit_link;
+
+static crit_node *cn=NULL;	///< The critical path state of each node.
+
+static char *part_name[CP_PARTS]={"compute", "send", "receive", "network", "stall"};	///< Names of the parts.
+
+/**
+* Releases a reference to a record, freeing it (and its predecessors) if it is not referred anymore.
+*/
+static void rec_release(crit_rec *r){
+	crit_rec *p;
+
+	while (r!=NULL && --r->refs==0){
+		p=r->prev;
+		free(r);
+		r=p;
+	}
+}
+
+/**
+* Copies a chain, taking a reference to its last message.
+*/
+static void chain_copy(crit_chain *dst, crit_chain *src){
+	*dst=*src;
+	if (dst->last!=NULL)
+		dst->last->refs++;
+}
+
+/**
+* Frees the chain & the messages of a node.
+*/
+static void reset_critical_node(long i){
+	crit_msg *m;
+
+	rec_release(cn[i].chain.last);
+	while ((m=cn[i].msgs)!=NULL){
+		cn[i].msgs=m->next;
+		if (m->sent)
+			rec_release(m->chain.last);
+		free(m);
+	}
+}
+
+/**
+* Starts the critical path tracking of all the nodes.
+*/
+void init_critical(){
+	long i, k;
+
+	if (critical_path<=0 && paraver[0]=='\0')
+		return;
+	if (cn==NULL)
+		cn=alloc(nprocs*sizeof(crit_node));
+	else
+		for (i=0; i<nprocs; i++)
+			reset_critical_node(i);
+	for (i=0; i<nprocs; i++){
+		for (k=0; k<CP_PARTS; k++){
+			cn[i].chain.part[k]=0;
+			cn[i].own[k]=0;
+		}
+		cn[i].chain.last=NULL;
+		cn[i].mark=sim_clock;
+		cn[i].stall_start=-1;
+		cn[i].end=sim_clock;
+		cn[i].msgs=NULL;
+	}
+}
+
+/**
+* Finds the first message to a node from a sender, with a tag & length.
+*
+* @param i The node receiving.
+* @param from The node sending.
+* @param task The tag.
+* @param length The length.
+* @param what The message looked for.
+* @param create Whether to create the message if it is not found.
+* @return A pointer to the link to the message, or NULL if not found and not created.
+*/
+static crit_msg ** find_msg(long i, long from, long task, long length, msg_find_t what, bool_t create){
+	crit_msg **m, *n;
+
+	for (m=&cn[i].msgs; *m!=NULL; m=&(*m)->next)
+		if ((*m)->from==from && (*m)->task==task && (*m)->length==length)
+			if ((what==MSG_UNSENT && !(*m)->sent) || (what==MSG_UNARRIVED && (*m)->arrived<length) ||
+					(what==MSG_COMPLETE && (*m)->sent && (*m)->arrived==length))
+				return m;
+	if (!create)
+		return NULL;
+	n=alloc(sizeof(crit_msg));
+	n->from=from;
+	n->task=task;
+	n->length=length;
+	n->sent=B_FALSE;
+	n->arrived=0;
+	n->arr_time=sim_clock;
+	n->link_node=-1;
+	n->link_port=0;
+	n->link_wait=0;
+	n->next=NULL;
+	*m=n;
+	return m;
+}
+
+/**
+* The head event of a node has finished: its time is added to the corresponding part.
+*
+* @param i The node.
+* @param head The type of the finished head event.
+*/
+void crit_head(long i, event_t head){
+	crit_part_t p;
+	CLOCK_TYPE t;
+
+	if (cn==NULL)
+		return;
+	prv_state(i, head, cn[i].mark);
+	t=sim_clock-cn[i].mark;
+	switch (head){
+		case COMPUTATION:
+			p=CP_COMPUTE;
+			break;
+		case RECEPTION:
+			p=CP_RECV;
+			break;
+		case NO_EVENT:
+			cn[i].mark=sim_clock;
+			return;
+		default:
+			p=CP_SEND;
+			break;
+	}
+	cn[i].chain.part[p]+=t;
+	cn[i].own[p]+=t;
+	cn[i].mark=sim_clock;
+	cn[i].end=sim_clock;
+}
+
+/**
+* A node has finished sending a message: its chain is annotated in the message.
+*
+* @param i The node sending.
+* @param e The sent event (pid is the destination).
+*/
+void crit_sent(long i, event e){
+	crit_msg *m;
+
+	if (cn==NULL)
+		return;
+	m=*find_msg(e.pid, i, e.task, e.length, MSG_UNSENT, B_TRUE);
+	chain_copy(&m->chain, &cn[i].chain);
+	m->chain.part[CP_SEND]+=sim_clock-cn[i].mark;	// The sent until now.
+	m->start_time=cn[i].mark;
+	m->sent_time=sim_clock;
+	m->sent=B_TRUE;
+}
+
+/**
+* A data packet has arrived to its destination: the link in which it waited most is annotated in its message.
+*
+* @param i The node receiving.
+* @param pkt The packet.
+*/
+void crit_arrival(long i, packet_t *pkt){
+	crit_msg **m;
+
+	if (cn==NULL || network[pkt->from].source==INDEPENDENT_SOURCE)
+		return;
+	m=find_msg(i, pkt->from, pkt->task, pkt->length, MSG_UNARRIVED, B_TRUE);
+	(*m)->arrived++;
+	(*m)->arr_time=sim_clock;
+	if (pkt->worst_wait>(*m)->link_wait){
+		(*m)->link_wait=pkt->worst_wait;
+		(*m)->link_node=pkt->worst_node;
+		(*m)->link_port=pkt->worst_port;
+	}
+}
+
+/**
+* A reception has finished.
+*
+* If the node had to wait for the message, its chain is replaced by the chain of the sender plus the
+* time of the message in the network.
+*
+* @param i The node receiving.
+* @param e The reception event.
+*/
+void crit_received(long i, event e){
+	crit_msg **m, *msg;
+	crit_rec *r;
+
+	if (cn==NULL)
+		return;
+	if ((m=find_msg(i, e.pid, e.task, e.length, MSG_COMPLETE, B_FALSE))==NULL)
+		return;	// Sent without tracking (e.g. before a rewind).
+	msg=*m;
+	*m=msg->next;
+	prv_comm(e.pid, i, e.task, e.length*pkt_len*phit_len, msg->start_time, msg->sent_time, cn[i].mark, msg->arr_time);
+	if (msg->arr_time>cn[i].mark){	// The node was waiting for this message.
+		cn[i].own[CP_RECV]+=sim_clock-cn[i].mark;
+		cn[i].mark=sim_clock;
+		cn[i].end=sim_clock;
+		r=alloc(sizeof(crit_rec));
+		r->from=e.pid;
+		r->to=i;
+		r->task=e.task;
+		r->length=e.length;
+		r->net=sim_clock-msg->sent_time;
+		r->link_node=msg->link_node;
+		r->link_port=msg->link_port;
+		r->link_wait=msg->link_wait;
+		r->refs=1;
+		r->prev=msg->chain.last;	// The reference of the message goes to the record.
+		rec_release(cn[i].chain.last);
+		cn[i].chain=msg->chain;
+		cn[i].chain.part[CP_NETWORK]+=r->net;
+		cn[i].chain.last=r;
+	}
+	else
+		rec_release(msg->chain.last);
+	free(msg);
+}
+
+/**
+* The injection of a node gets stalled (the injection queue is full) or resumes.
+*
+* @param i The node.
+* @param stalled TRUE if the injection has failed, FALSE if it has succeeded.
+*/
+void crit_stall(long i, bool_t stalled){
+	if (cn==NULL || network[i].source==INDEPENDENT_SOURCE)
+		return;
+	if (stalled && cn[i].stall_start<0)
+		cn[i].stall_start=sim_clock;
+	else if (!stalled && cn[i].stall_start>=0){
+		cn[i].own[CP_STALL]+=sim_clock-cn[i].stall_start;
+		cn[i].stall_start=-1;
+	}
+}
+
+/**
+* Sorts records by their network time, longest first.
+*/
+static int cmp_net(const void *a, const void *b){
+	CLOCK_TYPE x=(*(crit_rec **)a)->net, y=(*(crit_rec **)b)->net;
+
+	return (x<y)-(x>y);
+}
+
+/**
+* Sorts records by their worst link.
+*/
+static int cmp_link(const void *a, const void *b){
+	crit_rec *x=*(crit_rec **)a, *y=*(crit_rec **)b;
+
+	if (x->link_node!=y->link_node)
+		return (x->link_node<y->link_node)? -1 : 1;
+	return (x->link_port>y->link_port)-(x->link_port<y->link_port);
+}
+
+/**
+* Sorts links by their accumulated wait, longest first.
+*/
+static int cmp_wait(const void *a, const void *b){
+	CLOCK_TYPE x=((crit_link *)a)->wait, y=((crit_link *)b)->wait;
+
+	return (x<y)-(x>y);
+}
+
+/**
+* Prints the time breakdown of the tasks and the critical path, with the messages & links in it which take longest.
+*
+* At most #critical_path tasks (those which waited most), messages & links are listed.
+*/
+void print_critical(){
+	long i, k, n=0, n_links=0, n_tasks=0, last=-1, t, *order;
+	CLOCK_TYPE tot[CP_PARTS], len;
+	crit_rec *r, **recs;
+	crit_link *links;
+
+	if (cn==NULL || critical_path<=0)
+		return;
+	for (k=0; k<CP_PARTS; k++)
+		tot[k]=0;
+	for (i=0; i<nprocs; i++){
+		if (cn[i].own[CP_COMPUTE]+cn[i].own[CP_SEND]+cn[i].own[CP_RECV]==0)	// No task in this node.
+			continue;
+		n_tasks++;
+		for (k=0; k<CP_PARTS; k++)
+			tot[k]+=cn[i].own[k];
+		if (last<0 || cn[i].end>cn[last].end)
+			last=i;
+	}
+	if (last<0)
+		return;
+
+	printf("Task time breakdown (avg. cycles): compute %.0f, send %.0f (stalled %.0f), receive wait %.0f\n",
+		(double)tot[CP_COMPUTE]/n_tasks, (double)tot[CP_SEND]/n_tasks, (double)tot[CP_STALL]/n_tasks, (double)tot[CP_RECV]/n_tasks);
+	order=alloc(nprocs*sizeof(long));
+	for (i=0; i<nprocs; i++)
+		order[i]=i;
+	for (i=0; i<critical_path && i<nprocs; i++){	// Selects the tasks which waited most.
+		for (k=i+1; k<nprocs; k++)
+			if (cn[order[k]].own[CP_RECV]>cn[order[i]].own[CP_RECV]){
+				t=order[i];
+				order[i]=order[k];
+				order[k]=t;
+			}
+		if (cn[order[i]].own[CP_RECV]==0)
+			break;
+		printf("  node %6ld: compute %10"PRINT_CLOCK", send %10"PRINT_CLOCK" (stalled %10"PRINT_CLOCK"), receive wait %10"PRINT_CLOCK"\n", order[i],
+			cn[order[i]].own[CP_COMPUTE], cn[order[i]].own[CP_SEND], cn[order[i]].own[CP_STALL], cn[order[i]].own[CP_RECV]);
+	}
+	free(order);
+
+	len=0;
+	for (k=0; k<CP_STALL; k++)
+		len+=cn[last].chain.part[k];
+	printf("Critical path:                     %"PRINT_CLOCK" cycles, ending in node %ld\n", len, last);
+	for (k=0; k<CP_STALL; k++)
+		printf("  %-8s %12"PRINT_CLOCK" cycles (%5.1f%%)\n", part_name[k], cn[last].chain.part[k], (len>0)? 100.0*cn[last].chain.part[k]/len : 0.0);
+
+	for (r=cn[last].chain.last; r!=NULL; r=r->prev)
+		n++;
+	if (n==0)
+		return;
+	recs=alloc(n*sizeof(crit_rec *));
+	for (n=0, r=cn[last].chain.last; r!=NULL; r=r->prev)
+		recs[n++]=r;
+	printf("  %ld messages in the critical path. Longest in the network:\n", n);
+	qsort(recs, n, sizeof(crit_rec *), cmp_net);
+	for (i=0; i<n && i<critical_path; i++)
+		printf("    %6ld -> %6ld tag %6ld, %6ld packets: %10"PRINT_CLOCK" cycles in the network\n",
+			recs[i]->from, recs[i]->to, recs[i]->task, recs[i]->length, recs[i]->net);
+
+	links=alloc(n*sizeof(crit_link));
+	qsort(recs, n, sizeof(crit_rec *), cmp_link);
+	for (i=0; i<n; i++){
+		if (recs[i]->link_node<0)
+			continue;
+		if (n_links==0 || links[n_links-1].node!=recs[i]->link_node || links[n_links-1].port!=recs[i]->link_port){
+			links[n_links].node=recs[i]->link_node;
+			links[n_links].port=recs[i]->link_port;
+			links[n_links].wait=0;
+			links[n_links++].msgs=0;
+		}
+		links[n_links-1].wait+=recs[i]->link_wait;
+		links[n_links-1].msgs++;
+	}
+	qsort(links, n_links, sizeof(crit_link), cmp_wait);
+	printf("  Links in which the messages of the critical path waited most:\n");
+	for (i=0; i<n_links && i<critical_path; i++)
+		printf("    node %6ld port %3ld: %10"PRINT_CLOCK" cycles, worst link of %ld messages\n",
+			links[i].node, links[i].port, links[i].wait, links[i].msgs);
+	free(links);
+	free(recs);
+}
+#endif /* TRACE_SUPPORT */
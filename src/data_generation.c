@@ -264,13 +264,17 @@ void generate_phits(unsigned long packet, port_type iport) {
 	}
 
 	if (plevel & 1)
-		sources[pkt_space[packet].from][pkt_space[packet].to]++;
+		tmap_add(&sources, pkt_space[packet].from, pkt_space[packet].to);
 
 	sent_count++;
 #if (BIMODAL_SUPPORT != 0)
 	msg_sent_count[pkt_space[packet].mtype]++;
 #endif /* BIMODAL */
 	sent_phit_count += pkt_space[packet].size;
+#if (TRACE_SUPPORT != 0)
+	if (pattern == TRACE)
+		job_sent(pkt_space[packet].job, pkt_space[packet].size);
+#endif
 }
 
 /**
@@ -291,6 +295,7 @@ void generate_pkt(long i) {
 	inj_queue *qi;
 	port_type iport;
 	packet_t packet;
+	long (*pkt_rand)(long)=traffic_rand;	// The stream for the random numbers of this packet.
 
 //	if (network[i].source==NO_SOURCE) // Should not be testing this -- paranoid mode.
 //	{
@@ -305,7 +310,7 @@ void generate_pkt(long i) {
 		if (network[i].triggered==0){
 			if (network[i].source==INDEPENDENT_SOURCE)
 			{
-				aux=rand();
+				aux=traffic_rand(i);
 				if (aux > aload )
 					return;
 #if (BIMODAL_SUPPORT != 0)
@@ -319,29 +324,31 @@ void generate_pkt(long i) {
 #endif /* BIMODAL */
 			}
 		}
-		else
+		else {
 			network[i].triggered--;
+			pkt_rand=trigger_rand;	// Triggered packets do not disturb the offered traffic.
+		}
 
 		switch (pattern) {
 		// RANDOM DESTINATIONS
 		case HOTREGION:
-			aux = ((double)rand()/(double)(RAND_MAX));
+			aux = ((double)pkt_rand(i)/(double)(RAND_MAX));
 			if (aux <= 0.25)
 				do {
-					d = (long)(0.125*nprocs*rand()/(RAND_MAX+1.0));
+					d = (long)(0.125*nprocs*pkt_rand(i)/(RAND_MAX+1.0));
 				} while (d == i);
 			else
 				do {
-					d = (long)(1.0*nprocs*rand()/(RAND_MAX+1.0));
+					d = (long)(1.0*nprocs*pkt_rand(i)/(RAND_MAX+1.0));
 				} while (d == i);
 			break;
 		case HOTSPOT:
 			do {
-				aux = ((double)rand()/(double)(RAND_MAX));
+				aux = ((double)pkt_rand(i)/(double)(RAND_MAX));
                         	if (aux <= 0.02)
                                         d = 0; //((nodes_x/2)*(rand()%2))+(nodes_x*(nodes_y/2)*(rand()%2));	// The hot spots are (0,0); (0,Y/2); (X/2, Y/2); (X/2, 0);
                         	else
-                                        d = (long)(1.0*nprocs*rand()/(RAND_MAX+1.0));
+                                        d = (long)(1.0*nprocs*pkt_rand(i)/(RAND_MAX+1.0));
                         } while (d == i);
 			break;
 		case LOCAL:	// 50% distance 1, 25% distance 2-3, 12.5% distance 4-7, 12.5% rest of the network.
@@ -352,7 +359,7 @@ void generate_pkt(long i) {
 				double	rnd;	// the same number in range [0..1)
 
 				for (n=0; n<ndim; n++){
-					r=rand();
+					r=pkt_rand(i);
 					rnd=(1.0*r)/(RAND_MAX+1.0);
 					if (rnd<0.5)
 					{
@@ -393,15 +400,15 @@ void generate_pkt(long i) {
 			break;
 		case UNIFORM:
 			do {
-				d = (long)(1.0*nprocs*rand()/(RAND_MAX+1.0));
+				d = (long)(1.0*nprocs*pkt_rand(i)/(RAND_MAX+1.0));
 			} while (d == i);
 			break;
 		case SEMI:
 			if ( i%nodes_x < nodes_x/2 )
 				do {
 					long x,y;
-					x= rand()%(nodes_x/2);
-					y= rand()%nodes_y;
+					x= pkt_rand(i)%(nodes_x/2);
+					y= pkt_rand(i)%nodes_y;
 					d = x+(nodes_x*y);
 				} while (d == i);
 			else
@@ -435,23 +442,23 @@ void generate_pkt(long i) {
 				long dst[3]={0,0,0},	// the number of hops in each dimension.
 				     r;			// the total number of hops
 				do{
-					r=pop[rand()%POP_SIZE];
+					r=pop[pkt_rand(i)%POP_SIZE];
 				}while (r==0 || r>(nodes_x+nodes_y+nodes_z)/2);
 
 				if (ndim==3){
-					dst[D_Z]=rand()%(1+r);
+					dst[D_Z]=pkt_rand(i)%(1+r);
 					if (dst[D_Z]>nodes_z/2)
 						dst[D_Z]=nodes_z/2;
 					r-=dst[D_Z];
-					if (rand() & 1)
+					if (pkt_rand(i) & 1)
 						dst[D_Z]=-dst[D_Z];
 				}
 				if (ndim>1){
-					dst[D_Y]=rand()%(1+r);
+					dst[D_Y]=pkt_rand(i)%(1+r);
 					if (dst[D_Y]>nodes_y/2)
                                                 dst[D_Y]=nodes_y/2;
                                         r-=dst[D_Y];
-                                        if (rand() & 1)
+                                        if (pkt_rand(i) & 1)
                                                 dst[D_Y]=-dst[D_Y];
                                 }
 
@@ -459,7 +466,7 @@ void generate_pkt(long i) {
 				if (dst[D_X]>nodes_x/2)
 					dst[D_X]=nodes_x/2;
                                 r-=dst[D_X];
-                                if (rand() & 1)
+                                if (pkt_rand(i) & 1)
                                         dst[D_X]=-dst[D_X];
 
 				dst[D_X]=mod(dst[D_X]+network[i].rcoord[D_X],nodes_x);
@@ -475,27 +482,39 @@ void generate_pkt(long i) {
 #if (TRACE_SUPPORT != 0)
 		// Trace Based traffic
 		case TRACE:
+			packet.kind = SENDING;
+			packet.job = network[i].job;
 			if (network[i].source==INDEPENDENT_SOURCE) { // Background traffic - uniform
 				do {
-					d = (long)(1.0*nprocs*rand()/(RAND_MAX+1.0));
+					d = (long)(1.0*nprocs*pkt_rand(i)/(RAND_MAX+1.0));
 				} while (d == i || network[d].source!=INDEPENDENT_SOURCE);
 			} else {
-				if (!event_empty(&network[i].events)){
-					event e;
-					while (!event_empty(&network[i].events) && (e=head_event(&network[i].events)).type==RECEPTION){
-						if (occurred(&network[i].occurs, e))
-							rem_head_event(&network[i].events);
-						else
-							break;
-					}
-					if (!event_empty(&network[i].events) && head_event(&network[i].events).type==SENDING){
-						do_event(&network[i].events, &e);
-						packet.task = e.task;
-						packet.length = e.length;
-						d=e.pid;
-					}
+				event e;
+				trc_schedule(i);	// Messages for another thread may have arrived.
+				// Receptions already occurred & non-blocking events are done at once.
+				while (network[i].head==RECEPTION || network[i].head==IRECEPTION || network[i].head==RDV_ISENDING){
+					e=head_event(&network[i].events);
+					if (network[i].head==RECEPTION && !occurred(&network[i].occurs, e))
+						break;
+					if (network[i].head!=RECEPTION)
+						rdv_nonblocking(i, e);
 					else
-						return ;
+						crit_received(i, e);
+					rem_head_event(&network[i].events);
+					trc_head_changed(i);
+				}
+				// Control packets & data of non-blocking rendezvous sents go first.
+				if (rdv_packet(i, &packet, &d))
+					break;
+				if (network[i].head==SENDING || (network[i].head==RDV_SENDING && rdv_cleared(i))){
+					do_event(&network[i].events, &e);
+					if (e.count==e.length){
+						crit_sent(i, e);
+						trc_head_changed(i);
+					}
+					packet.task = e.task;
+					packet.length = e.length;
+					d=e.pid;
 				}
 				else
 					return ;
@@ -526,6 +545,10 @@ void generate_pkt(long i) {
 
 	for (;n>0;n--){
 		if (inj_queue_space(qi) < packet.size){
+#if (TRACE_SUPPORT != 0)
+			if (pattern == TRACE)
+				crit_stall(i, B_TRUE);
+#endif
 			if (!drop_packets){
 				network[i].saved_packet = packet;
 				network[i].pending_packet = n;
@@ -545,6 +568,12 @@ void generate_pkt(long i) {
 
 			packet.inj_time = sim_clock;  // Some additional info
 			packet.n_hops = 0;
+#if (TRACE_SUPPORT != 0)
+			packet.hop_time = sim_clock;
+			packet.worst_wait = 0;
+			packet.worst_node = -1;
+			packet.worst_port = 0;
+#endif
 			inj_phit_count += pkt_len;
 		}
 #if (BIMODAL_SUPPORT != 0)
@@ -556,13 +585,17 @@ void generate_pkt(long i) {
 		pkt_space[pkt] = packet;
 		generate_phits(pkt, iport);
 		packet.size = pkt_len;
-#if (PCOUNT!=0)
+#if (PCOUNT!=0 || ACTIVE_NODES!=0)
 		network[i].pcount+=packet.size;
 #endif
 		if(shotmode)
 			count[i]--;
 	}
 	network[i].pending_packet=0;
+#if (TRACE_SUPPORT != 0)
+	if (pattern == TRACE)
+		crit_stall(i, B_FALSE);
+#endif
 }
 
 /**
@@ -579,11 +612,10 @@ void data_generation(long i) {
 	if (i>=nprocs)
 		panic("Generating packets in a undefined node");
 #if (TRACE_SUPPORT != 0)
-	{
-		event e;
-		if(!event_empty(&network[i].events) && (e=head_event(&network[i].events)).type==COMPUTATION){
-			do_event(&network[i].events, &e);
-		}
+	// Computations are finished at once when the cycle annotated in cpu_end is reached.
+	if(network[i].head==COMPUTATION && network[i].cpu_end<=sim_clock){
+		rem_head_event(&network[i].events);
+		trc_head_changed(i);
 	}
 #endif
 	generate_pkt(i);
@@ -673,25 +705,104 @@ void data_injection(long i) {
 }
 
 /**
-* Initializes Injection.
+* Sets the provided load.
 *
-* Calculates all needed variables for injection & prepares all structures.
+* Calculates the thresholds used by the independent sources to inject.
+*
+* @param l The provided load, in phits/cycle/node.
 */
-void init_injection	(void) {
-	long i, scount;
-	long d;
+void set_load(double l){
+	load=l;
+#if (BIMODAL_SUPPORT != 0)
+	aload = (long) (load * RAND_MAX * (msglength * (1-lm_prob) + lm_prob) / (pkt_len * msglength));
+	lm_load = aload * lm_prob ;
+#else
+	// is the same as above when msglength=1 & lm_percent=0 (bimodal: off)
+	aload = (long) ( (load/pkt_len) * RAND_MAX);
+#endif /* BIMODAL */
+
+	if (aload<0) //Because an overflow
+		aload = RAND_MAX;
+}
+
+/**
+* Seed of a random stream of the traffic.
+*
+* Mixes the random seed & the stream id, so neighbour streams are not correlated.
+*
+* @param i The stream.
+* @return The seed of the stream.
+*/
+static unsigned int stream_seed(long i){
+	unsigned long long z=(unsigned long long)r_seed*0x9E3779B97F4A7C15ULL + (unsigned long long)(i+1)*0xBF58476D1CE4E5B9ULL;
+
+	z=(z^(z>>31))*0x94D049BB133111EBULL;
+	return (unsigned int)(z^(z>>29));
+}
+
+/**
+* Draws a random number for the traffic of a node.
+*
+* With common random numbers each node draws from its own stream, so the offered traffic is
+* the same whatever the number of draws made by the routers, & two configurations with the
+* same seed can be compared in pairs.
+*
+* @param i The node.
+* @return A random number in [0, RAND_MAX].
+*/
+long traffic_rand(long i){
+	if (crn)
+		return rand_r(&network[i].traffic_seed);
+	return rand();
+}
+
+/**
+* Draws a random number for the packets triggered by the packets consumed in a node.
+*
+* With common random numbers they have their own stream, as the consumptions depend on the policies.
+*
+* @param i The node.
+* @return A random number in [0, RAND_MAX].
+*
+* @see traffic_rand()
+*/
+long trigger_rand(long i){
+	if (crn)
+		return rand_r(&network[i].trigger_seed);
+	return rand();
+}
 
+/**
+* Sets the limit of the global congestion control.
+*
+* Calculates the number of packets allowed in the network from #global_cc.
+*/
+void set_congestion_limit(void){
 	if (topo<DIRECT)
 		net_capacity = NUMNODES * (radix * nways * nchan) * buffer_cap;
 	else
 		net_capacity = (NUMNODES - nprocs) * (radix * nways * nchan) * buffer_cap;
 
 	congestion_limit = (long)(net_capacity*(global_cc /	100.0));
+}
+
+/**
+* Initializes Injection.
+*
+* Calculates all needed variables for injection & prepares all structures.
+*/
+void init_injection	(void) {
+	long i, scount;
+	long d;
+
+	set_congestion_limit();
 
 	next_dest = alloc(sizeof(long)*nprocs);
 	scount = 0;
 	for (i=0; i<nprocs; i++) {
 		network[i].source=INDEPENDENT_SOURCE;
+		network[i].traffic_seed=stream_seed(2*i);
+		network[i].trigger_seed=stream_seed(2*i+1);
 		d = -1;
 		switch (pattern) {
 			case DISTRIBUTE:
@@ -39,6 +39,38 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 void init_event (event_q *q) {
 	q->head = NULL;
 	q->tail = NULL;
+	q->first = NULL;
+	q->keep = B_FALSE;
+	q->copies = 0;
+}
+
+/**
+* Keeps the events of a queue once they are done, so it can be rewound later.
+*
+* @param q a pointer to the queue.
+* @see rewind_events
+*/
+void keep_events (event_q *q) {
+	q->keep = B_TRUE;
+	q->first = q->head;
+}
+
+/**
+* Rewinds a queue whose events have been kept, so all of them can be done again.
+*
+* @param q a pointer to the queue.
+* @see keep_events
+*/
+void rewind_events (event_q *q) {
+	event_n *e;
+
+	if (!q->keep)
+		panic("Rewinding an event queue which has not been kept");
+	while (q->copies > 0)	// Only the loop events are kept, not their expansions.
+		rem_head_event(q);
+	for (e=q->first; e!=NULL; e=e->next)
+		e->ev.count=0;
+	q->head = q->first;
 }
 
 /**
@@ -54,6 +86,12 @@ void ins_event (event_q *q, event i) {
 	e->next = NULL;
 
 	if(q->head==NULL){ // Empty Queue
+		if (q->keep){ // Done events are still linked.
+			if (q->tail!=NULL)
+				q->tail->next = e;
+			else
+				q->first = e;
+		}
 		q->head = e;
 		q->tail = e;
 	}
@@ -63,6 +101,57 @@ void ins_event (event_q *q, event i) {
 	}
 }
 
+/**
+* Removes the head of a queue once it is done.
+*
+* The event is freed unless the queue keeps its done events. The copies of loop bodies are
+* always freed, as the kept loop events are expanded again when the queue is rewound.
+*
+* @param q a pointer to the queue.
+*/
+static void done_head (event_q *q) {
+	event_n *e = q->head;
+	bool_t copy = (q->copies > 0);
+
+	q->head = e->next;
+	if (copy)
+		q->copies--;
+	if (copy || !q->keep){
+		free (e);
+		if (q->head==NULL && !q->keep)
+			q->tail=NULL;
+	}
+}
+
+/**
+* Inserts a copy of all the events of a queue before the head of another one.
+*
+* @param q a pointer to the queue.
+* @param body a pointer to the queue whose events are copied.
+*/
+void push_events (event_q *q, event_q *body) {
+	event_n *e, *b, *first=NULL, *last=NULL;
+	long n=0;
+
+	for (b=body->head; b!=NULL; b=b->next, n++){
+		e=malloc(sizeof(event_n));
+		e->ev=b->ev;
+		e->next=NULL;
+		if (last==NULL)
+			first=e;
+		else
+			last->next=e;
+		last=e;
+	}
+	if (first==NULL)
+		return;
+	last->next=q->head;
+	if (q->head==NULL && !q->keep)
+		q->tail=last;
+	q->head=first;
+	q->copies+=n;
+}
+
 /**
 * Uses the first event in the queue.
 *
@@ -79,12 +168,8 @@ void do_event (event_q *q, event *i) {
 	e = q->head;
 	e->ev.count++;
 	*i = e->ev;
-	if (i->count == i->length){
-		q->head=q->head->next;
-		free (e);
-		if (q->head==NULL)
-			q->tail=NULL;
-	}
+	if (i->count == i->length)
+		done_head(q);
 }
 
 
@@ -105,12 +190,8 @@ void do_event_n_times (event_q *q, event *i, CLOCK_TYPE increment) {
 	e = q->head;
 	e->ev.count+=increment;
 	*i = e->ev;
-	if (i->count == i->length){
-		q->head=q->head->next;
-		free (e);
-		if (q->head==NULL)
-			q->tail=NULL;
-	}
+	if (i->count == i->length)
+		done_head(q);
 	if (i->count > i->length){
 		panic("Increment in do_event_n_times exceeded the count");
 	}
@@ -134,13 +215,9 @@ event head_event (event_q *q) {
 * @param q A pointer to the queue.
 */
 void rem_head_event (event_q *q) {
-	event_n *e;
 	if (q->head==NULL)
 		panic("Deleting event from an empty queue");
-	e = q->head;
-	q->head=q->head->next;
-	free (e);
-	if (q->head==NULL) q->tail=NULL;
+	done_head(q);
 }
 
 /**
@@ -153,6 +230,119 @@ bool_t event_empty (event_q *q){
 	return (q->head==NULL);
 }
 
+/**
+* Gets the first event of a queue which is not a copy of a loop body.
+*
+* The copies are at the head, and the kept done events are linked to the event after them.
+*
+* @param q A pointer to the queue.
+* @return The first pending event not copied from a loop, NULL if there is none.
+*/
+static event_n * after_copies (event_q *q) {
+	event_n *e = q->head;
+	long k;
+
+	for (k=0; k<q->copies; k++)
+		e = e->next;
+	return e;
+}
+
+/**
+* Saves or restores an event queue in a checkpoint.
+*
+* The pending events are saved, and also the done ones when they are kept, so the queue can be
+* rewound after restoring it. The events in the queue are replaced when restoring.
+*
+* @param q A pointer to the queue.
+*/
+void event_checkpoint (event_q *q) {
+	event_n *e, *rest, *done=NULL, *last=NULL, **link;
+	long n_done=0, n_pend=0, k;
+
+	if (ckpt_saving()){
+		rest = after_copies(q);
+		if (q->keep)
+			for (e=q->first; e!=rest; e=e->next)
+				n_done++;
+		for (e=q->head; e!=NULL; e=e->next)
+			n_pend++;
+		CKPT(q->keep);
+		CKPT(q->copies);
+		CKPT(n_done);
+		CKPT(n_pend);
+		if (q->keep)
+			for (e=q->first; e!=rest; e=e->next)
+				CKPT(e->ev);
+		for (e=q->head; e!=NULL; e=e->next)
+			CKPT(e->ev);
+		return;
+	}
+
+	// The events read from the trace are freed.
+	while (q->copies > 0)
+		rem_head_event(q);
+	for (e=(q->keep)? q->first : q->head; e!=NULL; e=rest){
+		rest = e->next;
+		free(e);
+	}
+
+	CKPT(q->keep);
+	CKPT(q->copies);
+	CKPT(n_done);
+	CKPT(n_pend);
+	for (link=&done, k=0; k<n_done; k++, link=&last->next){
+		last = *link = alloc(sizeof(event_n));
+		CKPT(last->ev);
+		last->next = NULL;
+	}
+	q->head = q->tail = NULL;
+	for (link=&q->head, k=0; k<n_pend; k++){
+		e = *link = alloc(sizeof(event_n));
+		CKPT(e->ev);
+		e->next = NULL;
+		link = &e->next;
+		if (k >= q->copies || !q->keep)	// The copies are not the tail of a kept queue.
+			q->tail = e;
+	}
+	rest = after_copies(q);
+	if (last != NULL){
+		last->next = rest;
+		if (q->tail == NULL)
+			q->tail = last;
+	}
+	q->first = (!q->keep)? NULL : (done != NULL)? done : rest;
+}
+
+/**
+* Saves or restores a list of occurred events in a checkpoint. The events are replaced when restoring.
+*
+* @param l A pointer to the list.
+*/
+void occur_checkpoint (event_l *l){
+	event_n *e, **link;
+	long n=0, k;
+
+	if (ckpt_saving()){
+		for (e=l->first; e!=NULL; e=e->next)
+			n++;
+		CKPT(n);
+		for (e=l->first; e!=NULL; e=e->next)
+			CKPT(e->ev);
+		return;
+	}
+	while ((e=l->first)!=NULL){
+		l->first=e->next;
+		free(e);
+	}
+	CKPT(n);
+	for (link=&l->first, k=0; k<n; k++){
+		e = *link = alloc(sizeof(event_n));
+		CKPT(e->ev);
+		e->next = NULL;
+		link = &e->next;
+	}
+}
+
 #if (TRACE_SUPPORT > 1)
 
 /**
@@ -257,6 +447,43 @@ bool_t occurred (event_l **l, event i){
 	}
 	return B_FALSE;
 }
+
+/**
+* Has an event completely occurred?, without deleting it from the list.
+*
+* Used to check the receptions of the threads not being performed in a node.
+*
+* @param l a pointer to a list.
+* @param i the event we are seeking for.
+* @return TRUE if the event has been occurred, elseway FALSE
+*/
+bool_t has_occurred (event_l **l, event i){
+	event_n *e;
+
+	for (e = (*l)[i.pid].first; e!=NULL; e = e->next)
+		if (e->ev.type == i.type && e->ev.pid == i.pid && e->ev.task == i.task &&
+			e->ev.length == i.length && e->ev.count == e->ev.length)
+			return B_TRUE;
+	return B_FALSE;
+}
+
+/**
+* Removes all the events in the occurred event lists of a node.
+*
+* Used when a node is given to another job, so it does not see the receptions of the previous one.
+*
+* @param l A pointer to the lists.
+*/
+void clear_occur (event_l **l){
+	event_n *e;
+	long i;
+
+	for (i=0; i<nprocs; i++)
+		while ((e=(*l)[i].first)!=NULL){
+			(*l)[i].first=e->next;
+			free(e);
+		}
+}
 #endif // Trace support with multilist #occurs
 
 #if (TRACE_SUPPORT == 1)
@@ -360,6 +587,41 @@ bool_t occurred (event_l *l, event i){
 	}
 	return B_FALSE;
 }
+
+/**
+* Has an event completely occurred?, without deleting it from the list.
+*
+* Used to check the receptions of the threads not being performed in a node.
+*
+* @param l a pointer to a list.
+* @param i the event we are seeking for.
+* @return TRUE if the event has been occurred, elseway FALSE
+*/
+bool_t has_occurred (event_l *l, event i){
+	event_n *e;
+
+	for (e = (*l).first; e!=NULL; e = e->next)
+		if (e->ev.type == i.type && e->ev.pid == i.pid && e->ev.task == i.task &&
+			e->ev.length == i.length && e->ev.count == e->ev.length)
+			return B_TRUE;
+	return B_FALSE;
+}
+
+/**
+* Removes all the events in the occurred event list of a node.
+*
+* Used when a node is given to another job, so it does not see the receptions of the previous one.
+*
+* @param l A pointer to the list.
+*/
+void clear_occur (event_l *l){
+	event_n *e;
+
+	while ((e=(*l).first)!=NULL){
+		(*l).first=e->next;
+		free(e);
+	}
+}
 #endif // Trace support with single list #occurs
 
 #endif
@@ -27,11 +27,19 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 * Types of event.
 *
 * It should be 'r' for a reception, 's' for a sent or 'c' for a computation event.
+* The rest are only used when modelling the eager/rendezvous protocol or when replaying loops.
 */
 typedef enum event_t {
+	NO_EVENT = 0,		///< No event (empty queue). Only used for tracking the head of a queue.
 	RECEPTION = 'r',	///< Reception
 	SENDING = 's',		///< Sent
-	COMPUTATION = 'c'	///< Computation
+	COMPUTATION = 'c',	///< Computation
+	RDV_SENDING = 'S',	///< Sent using the rendezvous protocol (blocking until the message is sent).
+	RDV_ISENDING = 'I',	///< Non-blocking sent using the rendezvous protocol.
+	IRECEPTION = 'i',	///< Non-blocking reception. Only posts the reception, which is waited by a later reception.
+	RTS = 'T',			///< Request to send. Control packet of the rendezvous protocol.
+	CTS = 'A',			///< Clear to send. Control packet of the rendezvous protocol.
+	LOOP = 'l'			///< A loop of a fsin trc file: task is the body and length the iterations. Expanded when it reaches the head.
 } event_t;
 
 /**
@@ -65,6 +73,9 @@ typedef struct event_n {
 typedef struct event_q {
 	event_n *head;	///< A pointer to the first event node (for removing).
 	event_n *tail;	///< A pointer to the last event node (for enqueuing).
+	event_n *first;	///< A pointer to the first event ever queued (for rewinding).
+	bool_t keep;	///< Whether the done events are kept, so the queue can be rewound.
+	long copies;	///< Events at the head copied from a loop body. They are freed once done, even when keeping.
 } event_q;
 
 /**
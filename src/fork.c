@@ -0,0 +1,151 @@
+/**
+* @file
+* @brief	Variants of the policies forked from a warm network.
+*
+* The variants file has a line for each variant, with the options it changes separated by spaces:
+*
+* amode=fifo
+* intransit_pr=0.5 global_cc=50
+*
+* Once the network is warmed up, a copy-on-write child is forked for each variant. The child changes its
+* policies (arbitration, injection mode, in-transit priority & global congestion control) & takes the
+* batches of the stationary phase, writing its report to #fork_file.<variant>.out and its output files
+* with the prefix <output>.<variant>. At most #sweep_workers variants run concurrently, the network
+* with the unchanged configuration being one of them, so all the variants share the same warm-up.
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef WIN32
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "globals.h"
+
+#define VARIANT_LINE 1024	///< Maximum length of a line in the variants file.
+
+static long running=0;		///< Number of variants running.
+static long n_variants=0;	///< Number of variants forked.
+
+/**
+* Changes the policies of a forked variant. Runs in the child, which goes on with the stationary phase.
+*
+* @param k The variant.
+* @param line The options changed in the variant.
+*/
+static void start_variant(long k, char *line){
+	char name[160], opt[VARIANT_LINE], *o, *next;
+
+	sprintf(name, "%s.%ld.out", fork_file, k);
+	if (freopen(name, "w", stdout)==NULL)
+		panic("Cannot write the output of a variant");
+	printf("Variant %ld forked at cycle %"PRINT_CLOCK": %s\n\n", k, sim_clock, line);
+
+	for (o=strtok_r(line, " \t", &next); o!=NULL; o=strtok_r(NULL, " \t", &next)){
+		strcpy(opt, o);	// get_option splits the string.
+		get_policy_option(opt);
+	}
+	init_policies();
+	set_intransit_priority();
+	set_congestion_limit();
+
+	sprintf(name, "%s.%ld", file, k);
+	strcpy(file, name);
+	fclose(fp);
+	sprintf(name, "%s.mon", file);
+	if((fp = fopen(name, "w")) == NULL)
+		panic("cannot create monitorized output file");
+	if (ckpt_file[0] != '\0'){
+		sprintf(name, "%s.%ld", ckpt_file, k);
+		strcpy(ckpt_file, name);
+	}
+	fork_file[0]='\0';
+	running=0;
+}
+
+/**
+* Waits for a variant to finish.
+*
+* @return TRUE if a variant has finished, FALSE if there are none running.
+*/
+static bool_t wait_variant(void){
+	while (running>0)
+		if (wait(NULL)>0){
+			running--;
+			return B_TRUE;
+		}
+		else if (errno!=EINTR)
+			running=0;
+	return B_FALSE;
+}
+
+/**
+* Forks a child for each variant in #fork_file, once the network is warmed up.
+*
+* The children return from this function with their policies changed, while the parent returns with its
+* policies unchanged when all the variants have been forked.
+*
+* @see wait_variants()
+*/
+void fork_variants(void){
+	FILE *f;
+	char line[VARIANT_LINE];
+	long workers=sweep_workers;
+	pid_t pid;
+
+	if ((f=fopen(fork_file, "r"))==NULL)
+		panic("Cannot read the variants file");
+	if (workers<=0)
+		workers=sysconf(_SC_NPROCESSORS_ONLN);
+	if (workers<2)
+		workers=2;	// At least one variant runs with the unchanged network.
+
+	while (fgets(line, VARIANT_LINE, f)!=NULL && !interrupted && !aborted){
+		line[strcspn(line, "\r\n")]='\0';
+		if (line[0]=='\0' || line[0]=='#')
+			continue;
+		while (running>=workers-1 && wait_variant())
+			;
+		if (interrupted)
+			break;
+		fflush(stdout);
+		fflush(fp);
+		if ((pid=fork())<0)
+			panic("Cannot fork a variant");
+		if (pid==0){
+			fclose(f);
+			start_variant(n_variants+1, line);
+			return;
+		}
+		running++;
+		n_variants++;
+	}
+	fclose(f);
+	printf("%ld variants forked at cycle %"PRINT_CLOCK"\n\n", n_variants, sim_clock);
+}
+
+/**
+* Waits for the forked variants to finish, once the parent has finished its own batches.
+*/
+void wait_variants(void){
+	while (wait_variant())
+		;
+	printf("\n%ld variants done, results in %s.<variant>.out\n", n_variants, fork_file);
+}
+#endif /* WIN32 */
@@ -126,6 +126,43 @@ static literal_t options_l[] = {
 	{ 61, "bw"},
 	{ 62, "trace_cpu_units"},
 	{ 62, "cpu_units"},
+	{ 63, "collectives"},	/* Algorithm to expand the collectives in traces */
+	{ 63, "coll_alg"},
+	{ 64, "eager_threshold"},	/* Largest message sent without rendezvous in traces */
+	{ 64, "eager"},
+	{ 65, "cpu_speed"},	/* CPU speed (MHz) for the cpu bursts of dimemas traces */
+	{ 65, "cpuspeed"},
+	{ 66, "op_per_cycle"},
+	{ 67, "file_time"},
+	{ 68, "file_scale"},
+	{ 69, "cpu_scale"},	/* Factor applied to all the cpu bursts in traces */
+	{ 70, "cpu_ratios"},	/* CPU/network speed ratios to replay the trace with */
+	{ 70, "speed_ratios"},
+	{ 71, "kernel"},	/* Synthetic kernel used instead of a trace file */
+	{ 72, "jobs"},	/* File with several traces to run concurrently */
+	{ 72, "jobfile"},
+	{ 73, "job_log"},	/* Jobs arriving along the simulation */
+	{ 73, "joblog"},
+	{ 74, "allocation"},	/* Placement strategy for the jobs in the log */
+	{ 75, "anneal_steps"},	/* Moves of each annealing chain of the placement optimizer */
+	{ 76, "critical_path"},	/* Critical path & time breakdown report of traces */
+	{ 77, "paraver"},	/* Base name of the paraver timeline files */
+	{ 78, "noise"},	/* Random noise added to each cpu burst */
+	{ 79, "slow_nodes"},	/* Fraction of slow nodes & their slowdown */
+	{ 80, "daemon"},	/* Period & length of the daemon run in each node */
+	{ 81, "analytic"},	/* Analytic pre-pass of the trace, with lower bounds of the runtime */
+	{ 82, "precision"},	/* Relative precision of the results to stop taking batches & maximum number of batches */
+	{ 83, "warm_up_mode"},	/* How to detect the end of the warm-up: fixed or mser */
+	{ 84, "saturation"},	/* Search of the saturation load: tolerance & cycles of each probe */
+	{ 85, "sweep"},	/* File with the grid of parameters of a sweep of simulations */
+	{ 86, "sweep_workers"},	/* Simulations of the sweep run concurrently */
+	{ 87, "checkpoint"},	/* File to write the checkpoints to */
+	{ 88, "checkpoint_period"},	/* Cycles between checkpoints */
+	{ 89, "restore"},	/* Checkpoint to restore the simulation from */
+	{ 90, "fork"},	/* File with the policy variants to fork from the warm network */
+	{ 91, "crn"},	/* Common random numbers: a random stream for the traffic of each node */
+	{ 92, "results"},	/* Format of the machine-readable results: text (none), json or csv */
+	{ 93, "map_sketch"},	/* Counters of each row of the sketch approximating the source/destination maps, 0 for exact maps */
 	{ 100, "fsin_cycle_relation"},
 	{ 101, "simics_cycle_relation"},
 	{ 103, "serv_addr"},
@@ -305,6 +342,64 @@ literal_t placement_l[] = {
 	{ DIAGONAL_PLACE,		"diagonal"},
 	{ ICUBE_PLACE,			"icube"},
 	{ FILE_PLACE,			"file"},
+	{ OPT_PLACE,			"optimized"},
+	LITERAL_END
+};
+
+/**
+* All the algorithms for expanding collectives are specified here.
+* @see literal.c
+*/
+literal_t coll_alg_l[] = {
+	{ NO_COLL,			"none"},
+	{ BINOMIAL_COLL,	"binomial"},
+	{ RING_COLL,		"ring"},
+	{ RDOUBLING_COLL,	"rdoubling"},
+	{ PAIRWISE_COLL,	"pairwise"},
+	LITERAL_END
+};
+
+/**
+* All the synthetic kernels are specified here.
+* @see literal.c
+*/
+literal_t kernel_l[] = {
+	{ NO_KERNEL,		"none"},
+	{ STENCIL_KERNEL,	"stencil"},
+	{ FFT_KERNEL,		"fft"},
+	{ ALLREDUCE_KERNEL,	"allreduce"},
+	LITERAL_END
+};
+
+/**
+* All the distributions of the noise of the cpu bursts are specified here.
+* @see literal.c
+*/
+literal_t noise_l[] = {
+	{ NO_NOISE,			"none"},
+	{ UNIFORM_NOISE,	"uniform"},
+	{ EXP_NOISE,		"exponential"},
+	LITERAL_END
+};
+
+/**
+* All the ways of detecting the end of the warm-up are specified here.
+* @see literal.c
+*/
+literal_t warm_up_l[] = {
+	{ FIXED_WARM_UP,	"fixed"},
+	{ MSER_WARM_UP,		"mser"},
+	LITERAL_END
+};
+
+/**
+* All the formats of the machine-readable results are specified here.
+* @see literal.c
+*/
+literal_t results_l[] = {
+	{ TEXT_RESULTS,	"text"},
+	{ JSON_RESULTS,	"json"},
+	{ CSV_RESULTS,	"csv"},
 	LITERAL_END
 };
 
@@ -341,14 +436,86 @@ void get_conf_file(char * fname) {
 */
 void get_conf(long argn, char ** args) {
 	long i;
+	char buffer[1024];
 
 	set_default_conf();
 	get_conf_file(DEFAULT_CONF_FILE);
-	for(i = 0; i < argn; ++i)
-		get_option(args[i]);
+	for(i = 0; i < argn; ++i){
+		strncpy(buffer, args[i], 1023);	// get_option splits the string, & the arguments may be parsed again in a sweep.
+		buffer[1023] = '\0';
+		get_option(buffer);
+	}
 	verify_conf();
 }
 
+/**
+* Gets an option of a variant forked from the warm network.
+*
+* Only the policies which do not change the structures of the network can be changed:
+* arbitration, injection mode, in-transit priority & global congestion control.
+* @param option The string which contains an option=value
+*/
+void get_policy_option(char * option) {
+	int opt;
+	char name[64];
+	char message[100];
+
+	if (sscanf(option, "%63[^=]", name) != 1 || !literal_value(options_l, name, &opt) ||
+			(opt != 14 && opt != 32 && opt != 33 && opt != 40)) {
+		sprintf(message, "Option %.40s cannot be changed in a variant", option);
+		panic(message);
+	}
+	get_option(option);
+
+	if (inj_mode != SHORTEST_INJ && (topo > DIRECT || ninj < ndim*nways))
+		panic("The injection mode of the variant needs more injectors than the network has");
+}
+
+/**
+* Does an option change the trace read: the nodes, the placement of the tasks or their events?
+*
+* A sweep which does not change any of them reads the trace only once.
+* @param name The name of the option.
+* @return TRUE if it changes the trace read or it is unknown, FALSE otherwise.
+*/
+bool_t trace_option(char * name) {
+	int opt;
+
+	if (!literal_value(options_l, name, &opt))
+		return B_TRUE;
+	switch (opt) {
+	case 3:		// Packet length, which the event lengths are given in.
+	case 4:
+	case 6:
+	case 7:
+	case 8:
+	case 9:
+	case 23:
+	case 54:
+	case 61:	// Bandwidth, units & speeds to convert the cpu bursts.
+	case 62:
+	case 63:
+	case 64:
+	case 65:
+	case 66:
+	case 67:
+	case 68:
+	case 71:
+	case 72:
+	case 73:
+	case 74:
+	case 75:
+		return B_TRUE;
+	case 19:	// The random & optimized placements depend on the seed.
+		return (bool_t)(placement == RANDOM_PLACE || placement == OPT_PLACE);
+	case 11:	// The optimized placement depends on the routing.
+	case 25:
+		return (bool_t)(placement == OPT_PLACE);
+	default:
+		return B_FALSE;
+	}
+}
+
 /**
 * Gets an option & its value.
 *
@@ -630,50 +797,7 @@ void get_option(char * option) {
 		sscanf(value, "%ld", &min_batch_size);
 		break;
 	case 54:
-		param = strtok(value, sep);
-		if(!literal_value(placement_l, param, (int*) &placement))
-			panic("get_conf: Unknown placement mode");
-		if (placement==SHIFT_PLACE){
-			param = strtok(NULL, sep);
-			if (param)
-				shift = atoi(param);
-			else
-				shift=0;
-		}
-        if (placement==ICUBE_PLACE){
-			param = strtok(NULL, sep);
-			if (param)
-				pnodes_x = atoi(param);
-			else
-				pnodes_x = 1;
-   			param = strtok(NULL, sep);
-			if (param)
-				pnodes_y = atoi(param);
-			else
-				pnodes_y = 1;
-			param = strtok(NULL, sep);
-			if (param)
-				pnodes_z = atoi(param);
-			else
-				pnodes_z = 1;
-		}
-		if (placement==FILE_PLACE){
-			param = strtok(NULL, sep);
-			if (param)
-				strcpy(placefile, param);
-			else
-				panic("placement from file requires a placement file");
-		}
-		param = strtok(NULL, sep);
-		if (param)
-			trace_nodes = atoi(param);
-		else
-			trace_nodes = 0;
-		param = strtok(NULL, sep);
-		if (param)
-			trace_instances = atoi(param);
-		else
-			trace_instances=0;
+		get_placement(value);
 		break;
 	case 55:
 #if (BIMODAL_SUPPORT != 0)
@@ -713,6 +837,145 @@ void get_option(char * option) {
 		if(!literal_value(cpu_units_l, value, (int*) &cpu_units))
 			panic("get_conf: Unknown CPU event unit");
 		break;
+	case 63:
+		if(!literal_value(coll_alg_l, value, (int*) &coll_alg))
+			panic("get_conf: Unknown collective algorithm");
+		break;
+	case 64:
+		sscanf(value, "%ld", &eager_threshold);
+		break;
+	case 65:
+		sscanf(value, "%lf", &cpu_speed);
+		break;
+	case 66:
+		sscanf(value, "%lf", &op_per_cycle);
+		break;
+	case 67:
+		sscanf(value, "%lf", &file_time);
+		break;
+	case 68:
+		sscanf(value, "%lf", &file_scale);
+		break;
+	case 69:
+		sscanf(value, "%lf", &cpu_scale);
+		break;
+	case 70:
+		cpu_ratios = alloc(sizeof(double)*(strlen(value)/2+1));
+		n_cpu_ratios = 0;
+		param = strtok(value, sep);
+		while (param){
+			if ((cpu_ratios[n_cpu_ratios++] = atof(param)) <= 0.0)
+				panic("get_conf: CPU/network speed ratios must be positive");
+			param = strtok(NULL, sep);
+		}
+		break;
+	case 71:
+		param = strtok(value, sep);
+		if(!literal_value(kernel_l, param, (int*) &kernel))
+			panic("get_conf: Unknown kernel");
+		param = strtok(NULL, sep);
+		if (param)
+			kernel_iters = atol(param);
+		param = strtok(NULL, sep);
+		if (param)
+			kernel_bytes = atol(param);
+		param = strtok(NULL, sep);
+		if (param)
+			kernel_cpu = atol(param);
+		break;
+	case 72:
+		sscanf(value, "%s", jobfile);
+		break;
+	case 73:
+		sscanf(value, "%s", joblog);
+		break;
+	case 74:
+		sscanf(value, "%s", allocation);
+		break;
+	case 75:
+		sscanf(value, "%ld", &anneal_steps);
+		break;
+	case 76:
+		sscanf(value, "%ld", &critical_path);
+		break;
+	case 77:
+		sscanf(value, "%s", paraver);
+		break;
+	case 78:
+		param = strtok(value, sep);
+		if(!literal_value(noise_l, param, (int*) &noise))
+			panic("get_conf: Unknown noise distribution");
+		param = strtok(NULL, sep);
+		if (param)
+			noise_mean = atof(param);
+		break;
+	case 79:
+		param = strtok(value, sep);
+		slow_fraction = atof(param);
+		param = strtok(NULL, sep);
+		if (param)
+			slow_factor = atof(param);
+		break;
+	case 80:
+		param = strtok(value, sep);
+		daemon_period = atol(param);
+		param = strtok(NULL, sep);
+		if (param)
+			daemon_len = atol(param);
+		break;
+	case 81:
+		sscanf(value, "%ld", &analytic);
+		break;
+	case 82:
+		param = strtok(value, sep);
+		ci_precision = atof(param);
+		param = strtok(NULL, sep);
+		if (param)
+			ci_max_samples = atol(param);
+		break;
+	case 83:
+		if(!literal_value(warm_up_l, value, (int*) &warm_up_mode))
+			panic("get_conf: Unknown warm-up mode");
+		break;
+	case 84:
+		param = strtok(value, sep);
+		sat_tolerance = atof(param);
+		param = strtok(NULL, sep);
+		if (param)
+			sat_probe = atol(param);
+		break;
+	case 85:
+		sscanf(value, "%s", sweep_file);
+		break;
+	case 86:
+		sscanf(value, "%ld", &sweep_workers);
+		break;
+	case 87:
+		sscanf(value, "%s", ckpt_file);
+		break;
+	case 88:
+		sscanf(value, "%"SCAN_CLOCK, &ckpt_period);
+		break;
+	case 89:
+		sscanf(value, "%s", restore_file);
+		break;
+	case 90:
+		sscanf(value, "%s", fork_file);
+		break;
+	case 91:
+		sscanf(value, "%ld", &aux);
+		if (aux)
+			crn = B_TRUE;
+		else
+			crn = B_FALSE;
+		break;
+	case 92:
+		if(!literal_value(results_l, value, (int*) &results_format))
+			panic("get_conf: Unknown results format");
+		break;
+	case 93:
+		sscanf(value, "%ld", &map_sketch);
+		break;
 #if (EXECUTION_DRIVEN != 0)
 	case 100:
 		sscanf(value, "%ld", &fsin_cycle_relation);
@@ -739,6 +1002,69 @@ void get_option(char * option) {
 	}
 }
 
+/**
+* Gets a placement strategy & its parameters.
+*
+* Sets the placement, its parameters and the number of trace nodes & instances.
+* @param value The string which contains the placement, e.g. shift_4_16_1.
+*/
+void get_placement(char * value) {
+	char * param;
+	char * sep=" _";
+
+	param = strtok(value, sep);
+	if(!literal_value(placement_l, param, (int*) &placement))
+		panic("get_conf: Unknown placement mode");
+	if (placement==SHIFT_PLACE){
+		param = strtok(NULL, sep);
+		if (param)
+			shift = atoi(param);
+		else
+			shift=0;
+	}
+	if (placement==ICUBE_PLACE){
+		param = strtok(NULL, sep);
+		if (param)
+			pnodes_x = atoi(param);
+		else
+			pnodes_x = 1;
+		param = strtok(NULL, sep);
+		if (param)
+			pnodes_y = atoi(param);
+		else
+			pnodes_y = 1;
+		param = strtok(NULL, sep);
+		if (param)
+			pnodes_z = atoi(param);
+		else
+			pnodes_z = 1;
+	}
+	if (placement==FILE_PLACE){
+		param = strtok(NULL, sep);
+		if (param)
+			strcpy(placefile, param);
+		else
+			panic("placement from file requires a placement file");
+	}
+	if (placement==OPT_PLACE){
+		param = strtok(NULL, sep);
+		if (param)
+			strcpy(placefile, param);
+		else
+			panic("optimized placement requires a file to write the placement to");
+	}
+	param = strtok(NULL, sep);
+	if (param)
+		trace_nodes = atoi(param);
+	else
+		trace_nodes = 0;
+	param = strtok(NULL, sep);
+	if (param)
+		trace_instances = atoi(param);
+	else
+		trace_instances=0;
+}
+
 /**
 * Verifies the simulation configuration.
 *
@@ -974,10 +1300,26 @@ void verify_conf(void) {
 
 	if (pattern == HOTREGION && nprocs < 8)
 		panic("Hotregion traffic pattern require more than 8 nodes");
+	if (kernel != NO_KERNEL || jobfile[0] != '\0' || joblog[0] != '\0')
+		pattern=TRACE;	// Kernels & jobs are run as traces.
+	if (kernel != NO_KERNEL && (jobfile[0] != '\0' || joblog[0] != '\0'))
+		panic("Kernels cannot be run as jobs");
+	if (placement == OPT_PLACE && (kernel != NO_KERNEL || jobfile[0] != '\0' || joblog[0] != '\0'))
+		panic("Optimized placement is only available for a single trace file");
+	if (jobfile[0] != '\0' && joblog[0] != '\0')
+		panic("A job file and a job log cannot be used together");
+	if (joblog[0] != '\0' && n_cpu_ratios > 1)
+		panic("A job log cannot be replayed with several speed ratios");
+	if (analytic > 0 && (kernel != NO_KERNEL || joblog[0] != '\0'))
+		panic("The analytic pre-pass needs the trace read before the simulation");
+	if (daemon_period < 0 || daemon_len < 0)
+		panic("The daemon period & length cannot be negative");
+	if (daemon_period > 0 && daemon_len >= daemon_period)
+		panic("The daemon length must be shorter than its period");	// Otherwise a node never gets the cpu.
 	if (pattern == TRACE){
 		drop_packets=B_FALSE;	// If some packet are dropped the simulation will never end.
 		extract=0;		// Same as previous.
-		samples=1;		// For final summary
+		samples=(n_cpu_ratios>1)? n_cpu_ratios : 1;	// For final summary: one sample for each replay.
 		shotmode=B_FALSE;
 		load=bg_load;   // generation rate of the background traffic.
 		if (trcfile==NULL)
@@ -988,7 +1330,7 @@ void verify_conf(void) {
 		msglength=1;	 // Bimodal injection not allowed while using traces.
 		lm_percent=0.0;
 #endif /* BIMODAL */
-		printf("         Setting samples to 1\n");
+		printf("         Setting samples to %ld\n", samples);
 
 		// Let's check the placement parameters
 		if (trace_nodes==0){
@@ -1043,20 +1385,45 @@ void verify_conf(void) {
 			shotsize = (nprocs-1);
 	}
 
+	if (sat_tolerance > 0.0){
+		if (pattern == TRACE || shotmode)
+			panic("The saturation search needs synthetic traffic in batch mode");
+		if (sat_probe < 2)
+			panic("The probes of the saturation search are too short");
+		samples = N_SAT_FRACTIONS;	// One batch for each fraction of the saturation load.
+	}
+
+	if ((ckpt_file[0] != '\0' || restore_file[0] != '\0') && (shotmode || sat_tolerance > 0.0))
+		panic("Checkpoints are only available in batch and trace driven simulations");
+#if (TRACE_SUPPORT != 0)
+	if ((ckpt_file[0] != '\0' || restore_file[0] != '\0') && pattern == TRACE &&
+			(jobfile[0] != '\0' || joblog[0] != '\0' || critical_path > 0 || paraver[0] != '\0'))
+		panic("Checkpoints of trace driven simulations are not available with jobs, the critical path or paraver");
+#endif
+
+	if (fork_file[0] != '\0' && (pattern == TRACE || shotmode || sat_tolerance > 0.0))
+		panic("Variants can only be forked in the batch simulation of synthetic traffic");
+#ifdef WIN32
+	if (fork_file[0] != '\0')
+		panic("Variants cannot be forked in windows");
+#endif
+
+	if (map_sketch < 0)
+		panic("verify_conf: The sketch of the maps cannot have a negative width");
+
+	if (ci_precision > 0.0 && pattern != TRACE && !shotmode && sat_tolerance <= 0.0){
+		if (ci_max_samples < CI_MIN_SAMPLES)
+			panic("The maximum number of batches must allow the minimum to estimate the precision");
+		samples = ci_max_samples;	// Upper bound, the run may stop before.
+	}
+
 	if (max_conv_time==0)
 		max_conv_time = (CLOCK_TYPE) 1000000L; // Should have converged in less than a million cycles.
 
 #if (BIMODAL_SUPPORT != 0)
 	lm_prob = lm_percent/(msglength-(lm_percent*(msglength-1)));
-	aload = (long) (load * RAND_MAX * (msglength * (1-lm_prob) + lm_prob) / (pkt_len * msglength));
-	lm_load = aload * lm_prob ;
-#else
-	// is the same as above when msglength=1 & lm_percent=0 (bimodal: off)
-	aload = (long) ( (load/pkt_len) * RAND_MAX);
 #endif /* BIMODAL */
-
-	if (aload<0) //Because an overflow
-		aload = RAND_MAX;
+	set_load(load);
 
 	trigger = trigger_rate * RAND_MAX;
 	trigger_dif = 1 + trigger_max - trigger_min;
@@ -1128,6 +1495,7 @@ void verify_conf(void) {
 */
 void set_default_conf (void) {
 	r_seed = 17;
+	crn = B_FALSE;
 
 	pkt_len = 16;
 	phit_len = 4;
@@ -1165,7 +1533,7 @@ void set_default_conf (void) {
 	plevel = 0;
 	pinterval = (CLOCK_TYPE) 1000L;
 	pheaders = 2047;
-	bheaders = 8191;
+	bheaders = 32767;
 	monitored = 1;
 	bub_adap[0] = 0;
 	bub_adap[1] = 0;
@@ -1188,7 +1556,45 @@ void set_default_conf (void) {
 	trace_instances=0;
     cpu_units=UNIT_NANOSECONDS;
     link_bw=10000; // 10 Gbps
+	coll_alg=NO_COLL;
+	eager_threshold=-1;
+	cpu_speed=1e6;
+	op_per_cycle=50;
+	file_time=73;
+	file_scale=3;
+	cpu_scale=1.0;
+	n_cpu_ratios=0;
+	kernel=NO_KERNEL;
+	jobfile[0]='\0';
+	joblog[0]='\0';
+	strcpy(allocation, "consecutive");
+	anneal_steps=0;
+	critical_path=0;
+	paraver[0]='\0';
+	noise=NO_NOISE;
+	noise_mean=0.01;
+	slow_fraction=0.0;
+	slow_factor=1.5;
+	daemon_period=0;
+	daemon_len=0;
+	analytic=0;
+	kernel_iters=10;
+	kernel_bytes=1024;
+	kernel_cpu=1000;
 	samples=10;
+	ci_precision=0.0;
+	ci_max_samples=100;
+	warm_up_mode=FIXED_WARM_UP;
+	results_format=TEXT_RESULTS;
+	map_sketch=0;
+	sat_tolerance=0.0;
+	sat_probe=(CLOCK_TYPE) 5000L;
+	sweep_file[0]='\0';
+	sweep_workers=0;
+	ckpt_file[0]='\0';
+	ckpt_period=0;
+	restore_file[0]='\0';
+	fork_file[0]='\0';
 	batch_time=(CLOCK_TYPE) 1000L;
 	min_batch_size=0;
 
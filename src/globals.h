@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "router.h"
 #include "pkt_mem.h"
 #include "batch.h"
+#include "tmap.h"
 
 #include <math.h>
 #include <time.h>
@@ -50,12 +51,14 @@ extern long nprocs;
 extern long n_ports;
 
 extern long r_seed;
+extern bool_t crn;
 extern long nodes_x, nodes_y, nodes_z;
 extern long binj_cap;
 extern long ninj;
 extern router  * network;
-extern long **destinations;
-extern long **sources;
+extern tmap_t destinations;
+extern tmap_t sources;
+extern long map_sketch;
 extern long * con_dst;
 extern long * inj_dst;
 extern long max_dst;
@@ -132,10 +135,27 @@ extern req_mode_t req_mode;
 extern inj_mode_t inj_mode;
 
 extern placement_t placement;
+extern coll_alg_t coll_alg;
+extern long eager_threshold;
+extern double cpu_speed, op_per_cycle, file_time, file_scale, cpu_scale;
+extern double *cpu_ratios;
+extern long n_cpu_ratios;
+extern kernel_t kernel;
+extern long kernel_iters, kernel_bytes, kernel_cpu;
 extern long shift;
 extern long trace_nodes;
 extern long trace_instances;
 extern char placefile[128];
+extern char jobfile[128];
+extern char joblog[128];
+extern char allocation[128];
+extern long anneal_steps;
+extern long critical_path;
+extern char paraver[128];
+extern noise_t noise;
+extern double noise_mean, slow_fraction, slow_factor;
+extern long daemon_period, daemon_len;
+extern long analytic;
 
 extern bool_t drop_packets;
 extern bool_t parallel_injection;
@@ -157,9 +177,28 @@ extern CLOCK_TYPE warm_up_period, warmed_up;
 extern CLOCK_TYPE conv_period;
 extern CLOCK_TYPE max_conv_time;
 extern long min_batch_size;
+extern double ci_precision;
+extern long ci_max_samples;
+extern warm_up_t warm_up_mode;
+extern results_t results_format;
+extern CLOCK_TYPE truncation;
 
 extern double acum_delay, acum_inj_delay;
 extern long max_delay, max_inj_delay;
+extern hist_t delay_hist, inj_delay_hist;
+extern hist_t run_delay_hist, run_inj_delay_hist;
+extern double percentiles[N_PERCENTILES];
+extern double sat_tolerance, sat_load;
+extern CLOCK_TYPE sat_probe;
+extern long sat_probes;
+extern double sat_fractions[N_SAT_FRACTIONS];
+extern char sweep_file[128];
+extern long sweep_workers;
+extern char ckpt_file[128];
+extern CLOCK_TYPE ckpt_period;
+extern char restore_file[128];
+extern char rng_state[128];
+extern char fork_file[128];
 extern double acum_sq_delay, acum_sq_inj_delay;
 extern double acum_hops;
 
@@ -193,14 +232,20 @@ extern void (* run_network)(void);
 
 void run_network_shotmode(void);
 void run_network_batch(void);
+void run_network_saturation(void);
 
 void report_receiving_tasks(void);
+void simulate(void);
 
 /* In data_generation.c */
 void init_injection (void);
 void data_generation(long i);
 void data_injection(long i);
 void datagen_oneshot(bool_t reset);
+void set_load(double l);
+void set_congestion_limit(void);
+long traffic_rand(long i);
+long trigger_rand(long i);
 
 void generate_pkt(long i);
 port_type select_input_port_shortest(long i, long dest);
@@ -212,6 +257,7 @@ port_type select_input_port_lpath(long i, long dest);
 /* In arbitrate.c */
 void reserve(long i, port_type d_p, port_type s_p);
 void arbitrate_init(void);
+void set_intransit_priority(void);
 void arbitrate_cons_single(long i);
 void arbitrate_cons_multiple(long i);
 void arbitrate_direct(long i, port_type d_p);
@@ -264,13 +310,23 @@ void consume_multiple(long i);
 void advance(long n, long p);
 void data_movement_direct(bool_t inject);
 void data_movement_indirect(bool_t inject);
+#if (ACTIVE_NODES!=0)
+void init_active_nodes();
+void activate_node(long i);
+long active_nodes();
+#endif
 
 /* In init_functions.c */
 void init_functions (void);
+void init_policies (void);
 
 /* In stats.c */
 void stats(long i);
 void reset_stats(void);
+void hist_reset(hist_t *h);
+void hist_record(hist_t *h, CLOCK_TYPE v);
+void hist_merge(hist_t *to, hist_t *from);
+double hist_percentile(hist_t *h, double p);
 
 /* In router.c */
 extern long nchan;
@@ -315,6 +371,7 @@ void create_thintree();
 void create_icube();
 
 /* In get_conf.c */
+void get_placement(char * value);
 extern literal_t vc_l[];
 extern literal_t routing_l[];
 extern literal_t rmode_l[];
@@ -325,8 +382,15 @@ extern literal_t cpu_units_l[];
 extern literal_t topology_l[];
 extern literal_t injmode_l[];
 extern literal_t placement_l[];
+extern literal_t coll_alg_l[];
+extern literal_t kernel_l[];
+extern literal_t noise_l[];
+extern literal_t warm_up_l[];
+extern literal_t results_l[];
 
 void get_conf(long, char **);
+void get_policy_option(char * option);
+bool_t trace_option(char *name);
 
 /* In print_results.c */
 void print_headers(void);
@@ -338,6 +402,33 @@ void results_partial(void);
 void save_batch_results();
 void print_batch_results(batch_t *b);
 void print_batch_results_vast(batch_t *b);
+void batch_checkpoint(void);
+
+/* In checkpoint.c */
+#define CKPT(x) ckpt_data(&(x), sizeof(x))	///< Saves or restores a variable in a checkpoint.
+void ckpt_data(void *p, size_t size);
+bool_t ckpt_saving(void);
+void write_checkpoint(void);
+void read_checkpoint(void);
+void checkpoint_cycle(void);
+
+/* In sweep.c */
+void run_sweep(long argn, char **args);
+
+/* In output.c */
+void write_results(time_t start_time, time_t end_time);
+
+/* In tmap.c */
+void tmap_init(tmap_t *m, long width);
+void tmap_reset(tmap_t *m);
+void tmap_add(tmap_t *m, long from, long to);
+void tmap_row(tmap_t *m, long from, long *row);
+long tmap_pairs(tmap_t *m, long from, long *dst, long *count);
+void tmap_checkpoint(tmap_t *m);
+
+/* In fork.c */
+void fork_variants(void);
+void wait_variants(void);
 
 /* In circulant.c */
 extern long step;	// 2nd dimension of a circulant graph
@@ -361,32 +452,119 @@ void init_queue (queue *q);
 void pkt_init();
 void free_pkt(unsigned long n);
 unsigned long get_pkt();
+bool_t pkt_all_free();
+void pkt_checkpoint();
 
 #if (TRACE_SUPPORT != 0)
  /* In trace.c */
+ extern long **translation;
+ extern long trc_pending;
  void read_trace();
+ void share_trace();
+ void place_tasks();
+ void read_trace_file();
+ void consecutive_placement();
+ void trc_volume(long i);
+ long trc_streams(long i);
+ event_n * trc_stream(long i, long k);
+ event_n * trc_loop_body(long l);
+ void clear_trace();
  void run_network_trc();
+ void trc_head_changed(long i);
+ void trc_schedule(long i);
+ void trc_finished_cpus();
+ void trc_checkpoint();
+
+/* In protocol.c */
+ extern long rdv_outstanding, rdv_waiting, rdv_msgs, rdv_cts;
+ extern CLOCK_TYPE rdv_handshake, rdv_blocked;
+ void init_protocol();
+ event_t rdv_send_type(long bytes, bool_t sync, bool_t blocking);
+ void rdv_new_head(long i, event e);
+ void rdv_nonblocking(long i, event e);
+ bool_t rdv_cleared(long i);
+ bool_t rdv_rts_arrived(long i, event e);
+ bool_t rdv_has_work(long i);
+ bool_t rdv_packet(long i, packet_t *pkt, long *d);
+ void rdv_arrival(long i, packet_t *pkt);
+ void rdv_checkpoint();
+
+/* In jobs.c */
+ extern long n_jobs;
+ void read_jobs();
+ void read_job_log();
+ void schedule_jobs();
+ CLOCK_TYPE next_job_arrival();
+ bool_t jobs_waiting();
+ void rewind_jobs();
+ void job_node_active(long i, bool_t active);
+ void job_sent(long j, long phits);
+ void job_rcvd(long j, CLOCK_TYPE del);
+ void print_jobs();
+
+/* In place_opt.c */
+ void place_volume(long from, long to, double w);
+ void optimized_placement();
+
+/* In critical.c */
+ void init_critical();
+ void crit_head(long i, event_t head);
+ void crit_sent(long i, event e);
+ void crit_arrival(long i, packet_t *pkt);
+ void crit_received(long i, event e);
+ void crit_stall(long i, bool_t stalled);
+ void print_critical();
+
+/* In paraver.c */
+ void init_paraver();
+ void prv_state(long i, event_t head, CLOCK_TYPE start);
+ void prv_comm(long from, long to, long tag, long bytes, CLOCK_TYPE lsend, CLOCK_TYPE psend, CLOCK_TYPE lrecv, CLOCK_TYPE precv);
+ void close_paraver();
+
+/* In analytic.c */
+ void analytic_prepass();
+
+/* In noise.c */
+ extern CLOCK_TYPE noise_cycles;
+ void init_noise();
+ CLOCK_TYPE cpu_noise(long i, CLOCK_TYPE start, CLOCK_TYPE len);
+ void noise_checkpoint();
+
+/* In kernel.c */
+ void init_kernel();
+ void rewind_kernel();
+ bool_t kernel_next(long i);
+ void kernel_checkpoint();
 
 /* In event.c */
  void init_event (event_q *q);
+ void keep_events (event_q *q);
+ void rewind_events (event_q *q);
  void ins_event (event_q *q, event i);
+ void push_events (event_q *q, event_q *body);
  void do_event (event_q *q, event *i);
  void do_event_n_times (event_q *q, event *i, CLOCK_TYPE increment);
  event head_event (event_q *q);
  void rem_head_event (event_q *q);
  bool_t event_empty (event_q *q);
+ void event_checkpoint (event_q *q);
+ void occur_checkpoint (event_l *l);
 #endif /* TRACE common */
 
 #if (TRACE_SUPPORT > 1)
  void init_occur (event_l **l);
  void ins_occur (event_l **l, event i);
  bool_t occurred (event_l **l, event i);
+ bool_t has_occurred (event_l **l, event i);
+ void clear_occur (event_l **l);
 #endif /* TRACE multilist */
 
 #if (TRACE_SUPPORT == 1)
  void init_occur (event_l *l);
  void ins_occur (event_l *l, event i);
  bool_t occurred (event_l *l, event i);
+ bool_t has_occurred (event_l *l, event i);
+ void clear_occur (event_l *l);
 #endif /* TRACE single list */
 
 #if (EXECUTION_DRIVEN != 0)
@@ -105,7 +105,7 @@ routing_r icube_4mesh_rr (long source, long destination) {
 	long sx,sy=-1, dx,dy=-1, p;
 	routing_r res;
 
-	res.rr=alloc(ndim+1*sizeof(long));
+	res.rr=alloc((ndim+1)*sizeof(long));
 	res.rr[ndim]=0;
 
 	res.size=2;	// 2 hops: From NIC to first switch + From last switch to NIC.
@@ -173,7 +173,7 @@ routing_r icube_1mesh_rr (long source, long destination) {
 	long sx,sy=-1,sz=-1, dx,dy=-1,dz=-1;
 	routing_r res;
 
-	res.rr=alloc(ndim+1*sizeof(long)); // the last dimension is the number of parallel mesh to be used.
+	res.rr=alloc((ndim+1)*sizeof(long)); // the last dimension is the number of parallel mesh to be used.
 	res.size=2;	// 2 hops: From NIC to first switch + From last switch to NIC.
 
 	sx=network[source].rcoord[D_X];
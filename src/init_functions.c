@@ -41,12 +41,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 * @see data_movement
 */
 void init_functions (void) {
-	long i, j;
+	long i;
 
 	if (shotmode) run_network = run_network_shotmode;
 #if (TRACE_SUPPORT != 0)
 	else if (pattern == TRACE) run_network = run_network_trc;
 #endif
+	else if (sat_tolerance > 0.0) run_network = run_network_saturation;
 	else run_network = run_network_batch;
 
 #if (EXECUTION_DRIVEN != 0)
@@ -61,17 +62,8 @@ void init_functions (void) {
 	port_utilization = alloc(sizeof(CLOCK_TYPE)*n_ports);
 
 	if (plevel & 1) {
-		destinations = alloc(sizeof(long *)*nprocs);
-		sources = alloc(sizeof(long *)*nprocs);
-
-		for (i=0; i<nprocs; i++) {
-			destinations[i]=alloc(sizeof(long)*nprocs);
-			sources[i]=alloc(sizeof(long)*nprocs);
-			for (j=0; j<nprocs; j++){
-				destinations[i][j]=0;
-				sources[i][j]=0;
-			}
-		}
+		tmap_init(&destinations, map_sketch);
+		tmap_init(&sources, map_sketch);
 	}
 
 	if (plevel & 4){
@@ -264,6 +256,34 @@ void init_functions (void) {
 			panic("Bad consumption mode initializing");
 	}
 
+	init_policies();
+
+	if (topo<DIRECT)
+	{
+		data_movement = data_movement_direct;
+		arbitrate = arbitrate_direct;
+	}
+	else
+	{
+		data_movement = data_movement_indirect;
+		if (topo==ICUBE)
+			arbitrate = arbitrate_icube;
+		else
+		    arbitrate = arbitrate_trees;
+	}
+}
+
+
+/**
+* Initialization of the policy functions: arbitration & injection.
+*
+* Called again in the variants forked from a warm network, once their policies have been changed.
+*
+* @see arbitrate_select
+* @see select_input_port
+* @see fork_variants
+*/
+void init_policies (void) {
 	switch (arb_mode) {
 		case ROUNDROBIN_ARB:
 			arbitrate_select = arbitrate_select_round_robin;
@@ -303,19 +323,4 @@ void init_functions (void) {
 		default:
 			panic("Bad injection mode initializing");
 	}
-
-	if (topo<DIRECT)
-	{
-		data_movement = data_movement_direct;
-		arbitrate = arbitrate_direct;
-	}
-	else
-	{
-		data_movement = data_movement_indirect;
-		if (topo==ICUBE)
-			arbitrate = arbitrate_icube;
-		else
-		    arbitrate = arbitrate_trees;
-	}
 }
-
@@ -0,0 +1,396 @@
+/**
+* @file
+* @brief	Several traces (jobs) replayed concurrently in the same network.
+*
+* Each line of the job file has a trace file and its placement, written as in the placement
+* option (e.g. "bt.trc random_16"). The number of tasks of each job must be given. Each job is
+* placed with its own strategy; nodes already used by a previous job are replaced by the next
+* free ones. The completion time, the delay of the packets & the injected load are kept per job.
+*
+* Jobs can also arrive along the simulation, from a job log whose lines have the arrival cycle,
+* the number of tasks and the trace of each job (plus, optionally, its run time when running alone).
+* They are scheduled in arrival order (FCFS) as soon as there are enough free nodes, which are
+* allocated with the #allocation strategy. The trace of a job is not read until it is started.
+* This file is only used when compiling with TRACE_SUPPORT != 0
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <string.h>
+
+#include "globals.h"
+
+#if (TRACE_SUPPORT != 0)
+
+/**
+* A job: a trace running in a set of nodes.
+*/
+typedef struct job_t {
+	char trcfile[128];	///< The trace of the job.
+	long nodes;			///< Number of nodes used by the job.
+	long pending;		///< Number of nodes of the job with events still to occur.
+	CLOCK_TYPE start;	///< Cycle in which the job started.
+	CLOCK_TYPE end;		///< Cycle in which the job finished.
+	double sent_phits;	///< Phits injected by the job.
+	double rcvd;		///< Packets of the job received.
+	double acum_delay;	///< Accumulated delay of the packets of the job.
+	CLOCK_TYPE max_delay;	///< Maximum delay of the packets of the job.
+	CLOCK_TYPE arrival;	///< Cycle in which the job arrives (job logs only).
+	CLOCK_TYPE alone;	///< Run time of the job when running alone, 0 if unknown (job logs only).
+	long *node;			///< The nodes allocated to the job (job logs only).
+} job_t;
+
+static job_t *jobs=NULL;	///< All the jobs.
+long n_jobs=0;				///< Number of jobs.
+static long next_start=0;	///< First job of the log not started yet. Jobs are started in order.
+static long free_nodes=0;	///< Number of nodes not allocated to any job.
+
+/**
+* Reads the jobs, placing each one & reading its trace.
+*/
+void read_jobs(){
+	FILE *fjob;
+	char buffer[512];
+	char *tok, *spec, *trc=trcfile;
+	char sep[]=" \t";
+	bool_t *used;
+	long i, t, inst, d, used_nodes=0, max_jobs=0;
+
+	if((fjob = fopen(jobfile, "r")) == NULL){
+		printf("%s\n", jobfile);
+		panic("Job file not found in current directory");
+	}
+	used=alloc(nprocs*sizeof(bool_t));
+	for (i=0; i<nprocs; i++)
+		used[i]=B_FALSE;
+
+	while(fgets(buffer, 512, fjob) != NULL) {
+		if(buffer[0] == '\n' || buffer[0] == '#')
+			continue;
+		if(buffer[strlen(buffer) - 1] == '\n')
+			buffer[strlen(buffer) - 1] = '\0';
+		tok = strtok(buffer, sep);
+		spec = strtok(NULL, sep);
+		if (tok==NULL || spec==NULL)
+			panic("Each job requires a trace file and a placement");
+
+		if (n_jobs==max_jobs){
+			max_jobs=2*max_jobs+4;
+			if ((jobs=realloc(jobs, max_jobs*sizeof(job_t)))==NULL)
+				panic("Not enough memory for the jobs");
+		}
+		strcpy(jobs[n_jobs].trcfile, tok);
+		get_placement(spec);
+		if (trace_nodes==0)
+			panic("The number of tasks of each job must be given in its placement");
+		if (trace_instances==0)
+			trace_instances=1;
+		jobs[n_jobs].nodes=trace_nodes*trace_instances;
+		if ((used_nodes+=jobs[n_jobs].nodes)>nprocs)
+			panic("Too much nodes for these jobs");
+
+		translation=alloc(trace_nodes*sizeof(long *));
+		for (t=0; t<trace_nodes; t++)
+			translation[t]=alloc(trace_instances*sizeof(long));
+		place_tasks();
+		for (t=0; t<trace_nodes; t++)
+			for (inst=0; inst<trace_instances; inst++){
+				for (d=translation[t][inst]; used[d]; d=(d+1)%nprocs)
+					;
+				used[d]=B_TRUE;
+				translation[t][inst]=d;
+				network[d].job=n_jobs;
+			}
+		trcfile=jobs[n_jobs].trcfile;
+		read_trace_file();
+		for (t=0; t<trace_nodes; t++)
+			free(translation[t]);
+		free(translation);
+		n_jobs++;
+	}
+	fclose(fjob);
+	trcfile=trc;
+	translation=NULL;	// Each job had its own, there is no single mapping of the tasks.
+	trace_nodes=0;
+	if (n_jobs==0)
+		panic("No jobs in the job file");
+
+	for (i=0; i<nprocs; i++)
+		network[i].source=(used[i])? OTHER_SOURCE : INDEPENDENT_SOURCE;
+	free(used);
+	rewind_jobs();
+}
+
+/**
+* Reads a job log. The jobs are started later, as they arrive.
+*
+* @see schedule_jobs
+*/
+void read_job_log(){
+	FILE *flog;
+	char buffer[512];
+	char *tok;
+	char sep[]=" \t";
+	long i, max_jobs=0;
+
+	if((flog = fopen(joblog, "r")) == NULL){
+		printf("%s\n", joblog);
+		panic("Job log not found in current directory");
+	}
+	while(fgets(buffer, 512, flog) != NULL) {
+		if(buffer[0] == '\n' || buffer[0] == '#')
+			continue;
+		if(buffer[strlen(buffer) - 1] == '\n')
+			buffer[strlen(buffer) - 1] = '\0';
+		if (n_jobs==max_jobs){
+			max_jobs=2*max_jobs+4;
+			if ((jobs=realloc(jobs, max_jobs*sizeof(job_t)))==NULL)
+				panic("Not enough memory for the jobs");
+		}
+		if ((tok = strtok(buffer, sep))==NULL)
+			continue;
+		jobs[n_jobs].arrival=atoll(tok);
+		tok = strtok(NULL, sep);
+		jobs[n_jobs].nodes=(tok)? atol(tok) : 0;
+		tok = strtok(NULL, sep);
+		if (tok==NULL || jobs[n_jobs].nodes<=0 || jobs[n_jobs].nodes>nprocs)
+			panic("Each job requires its arrival, a valid number of tasks and a trace file");
+		strcpy(jobs[n_jobs].trcfile, tok);
+		tok = strtok(NULL, sep);
+		jobs[n_jobs].alone=(tok)? atoll(tok) : 0;
+		if (n_jobs>0 && jobs[n_jobs].arrival<jobs[n_jobs-1].arrival)
+			panic("The jobs in the log must be sorted by arrival");
+		jobs[n_jobs].node=NULL;
+		n_jobs++;
+	}
+	fclose(flog);
+	if (n_jobs==0)
+		panic("No jobs in the job log");
+
+	for (i=0; i<nprocs; i++)
+		network[i].source=INDEPENDENT_SOURCE;
+	free_nodes=nprocs;
+	next_start=0;
+	rewind_jobs();
+}
+
+/**
+* Frees the nodes of a finished job of the log.
+*
+* The receptions left in the nodes are removed, so the next job using them does not find them.
+*/
+static void finish_job(long j){
+	long t;
+
+	for (t=0; t<jobs[j].nodes; t++){
+		network[jobs[j].node[t]].job=-1;
+		network[jobs[j].node[t]].source=INDEPENDENT_SOURCE;
+		clear_occur(&network[jobs[j].node[t]].occurs);
+	}
+	free_nodes+=jobs[j].nodes;
+}
+
+/**
+* Starts a job of the log: allocates its nodes, reads its trace & sets the heads of its nodes.
+*
+* @param j The job.
+*/
+static void start_job(long j){
+	bool_t *used;
+	char spec[128];
+	char *trc=trcfile;
+	long i, t, d;
+
+	used=alloc(nprocs*sizeof(bool_t));
+	for (i=0; i<nprocs; i++)
+		used[i]=(network[i].job>=0);
+
+	strcpy(spec, allocation);
+	get_placement(spec);
+	trace_nodes=jobs[j].nodes;
+	trace_instances=1;
+	translation=alloc(trace_nodes*sizeof(long *));
+	for (t=0; t<trace_nodes; t++)
+		translation[t]=alloc(sizeof(long));
+	place_tasks();	// Sets all nodes as independent sources.
+
+	jobs[j].node=alloc(trace_nodes*sizeof(long));
+	for (t=0; t<trace_nodes; t++){
+		for (d=translation[t][0]; used[d]; d=(d+1)%nprocs)
+			;
+		used[d]=B_TRUE;
+		translation[t][0]=d;
+		jobs[j].node[t]=d;
+		network[d].job=j;
+	}
+	for (i=0; i<nprocs; i++)
+		network[i].source=(used[i])? OTHER_SOURCE : INDEPENDENT_SOURCE;
+	free(used);
+	free_nodes-=trace_nodes;
+
+	trcfile=jobs[j].trcfile;
+	read_trace_file();
+	trcfile=trc;
+	for (t=0; t<trace_nodes; t++)
+		free(translation[t]);
+	free(translation);
+	translation=NULL;
+	trace_nodes=0;
+
+	jobs[j].start=sim_clock;
+	for (t=0; t<jobs[j].nodes; t++){
+		trc_head_changed(jobs[j].node[t]);
+#if (ACTIVE_NODES!=0)
+		activate_node(jobs[j].node[t]);
+#endif
+	}
+	if (jobs[j].pending==0){	// Empty trace: no node will finish it.
+		jobs[j].end=sim_clock;
+		finish_job(j);
+	}
+}
+
+/**
+* Starts the jobs of the log which have arrived, in order, while there are enough free nodes.
+*
+* If nothing is running and the next job has not arrived yet, the simulation jumps to its arrival.
+*/
+void schedule_jobs(){
+	if (joblog[0]=='\0' || next_start==n_jobs)
+		return;
+	if (trc_pending==0 && rdv_outstanding==0 && pkt_all_free() && jobs[next_start].arrival>sim_clock){
+		printf("%11"PRINT_CLOCK":: Skipped %"PRINT_CLOCK" cycles until the arrival of job %ld\n",sim_clock, jobs[next_start].arrival-sim_clock, next_start);
+		sim_clock=jobs[next_start].arrival;
+	}
+	while (next_start<n_jobs && jobs[next_start].arrival<=sim_clock && jobs[next_start].nodes<=free_nodes)
+		start_job(next_start++);
+}
+
+/**
+* Gets the next cycle in which something could happen in the scheduler.
+*
+* @return The arrival of the next job to start, or CLOCK_MAX if there are no more jobs to start.
+*/
+CLOCK_TYPE next_job_arrival(){
+	if (joblog[0]=='\0' || next_start==n_jobs)
+		return CLOCK_MAX;
+	return jobs[next_start].arrival;
+}
+
+/**
+* Are there jobs in the log still to start?
+*/
+bool_t jobs_waiting(){
+	return (joblog[0]!='\0' && next_start<n_jobs);
+}
+
+/**
+* Restarts the statistics of all the jobs, before replaying them.
+*/
+void rewind_jobs(){
+	long j;
+
+	for (j=0; j<n_jobs; j++){
+		jobs[j].pending=0;
+		jobs[j].start=sim_clock;
+		jobs[j].end=sim_clock;
+		jobs[j].sent_phits=0.0;
+		jobs[j].rcvd=0.0;
+		jobs[j].acum_delay=0.0;
+		jobs[j].max_delay=0;
+	}
+}
+
+/**
+* A node starts or finishes its events.
+*
+* @param i The node.
+* @param active TRUE if the node has got events to do, FALSE if it has finished.
+*/
+void job_node_active(long i, bool_t active){
+	long j=network[i].job;
+
+	if (j<0)
+		return;
+	if (active)
+		jobs[j].pending++;
+	else if (--jobs[j].pending==0){
+		jobs[j].end=sim_clock;
+		if (joblog[0]!='\0')
+			finish_job(j);
+	}
+}
+
+/**
+* A packet of a job has been injected.
+*
+* @param j The job, -1 for background traffic.
+* @param phits The size of the packet.
+*/
+void job_sent(long j, long phits){
+	if (j>=0)
+		jobs[j].sent_phits+=phits;
+}
+
+/**
+* A packet of a job has been received.
+*
+* @param j The job, -1 for background traffic.
+* @param del The delay of the packet.
+*/
+void job_rcvd(long j, CLOCK_TYPE del){
+	if (j<0)
+		return;
+	jobs[j].rcvd++;
+	jobs[j].acum_delay+=del;
+	if (del>jobs[j].max_delay)
+		jobs[j].max_delay=del;
+}
+
+/**
+* Prints the results of each job.
+*/
+void print_jobs(){
+	long j;
+	CLOCK_TYPE t;
+
+	if (joblog[0]!='\0'){
+		printf("Jobs from %s, allocation %s:\n", joblog, allocation);
+		for (j=0; j<n_jobs; j++){
+			if (j>=next_start){
+				printf("  %3ld: %-24s %6ld nodes, not started\n", j, jobs[j].trcfile, jobs[j].nodes);
+				continue;
+			}
+			t=jobs[j].end-jobs[j].start;
+			printf("  %3ld: %-24s %6ld nodes, arrival %10"PRINT_CLOCK", wait %10"PRINT_CLOCK", run %10"PRINT_CLOCK", avg. delay %10.2f",
+				j, jobs[j].trcfile, jobs[j].nodes, jobs[j].arrival, jobs[j].start-jobs[j].arrival, t,
+				(jobs[j].rcvd>0)? jobs[j].acum_delay/jobs[j].rcvd : 0.0);
+			if (jobs[j].alone>0)
+				printf(", slowdown %1.3f", (double)t/jobs[j].alone);
+			printf("\n");
+		}
+		return;
+	}
+	printf("Jobs from %s:\n", jobfile);
+	for (j=0; j<n_jobs; j++){
+		t=jobs[j].end-jobs[j].start;
+		printf("  %3ld: %-24s %6ld nodes, %10"PRINT_CLOCK" cycles, avg. delay %10.2f, max. delay %8"PRINT_CLOCK", inj. load %1.5f\n",
+			j, jobs[j].trcfile, jobs[j].nodes, t,
+			(jobs[j].rcvd>0)? jobs[j].acum_delay/jobs[j].rcvd : 0.0, jobs[j].max_delay,
+			(t>0)? jobs[j].sent_phits/(jobs[j].nodes*(double)t) : 0.0);
+	}
+}
+#endif /* TRACE_SUPPORT */
@@ -0,0 +1,189 @@
+/**
+* @file
+* @brief	Synthetic application kernels for trace driven simulation.
+*
+* The kernels generate the events of each node as the simulation goes on, instead of
+* reading them from a trace file. Only the events of the current step of each node are
+* kept in its event queue, so memory does not depend on the number of iterations.
+* Tasks are mapped onto the nodes using the placement strategies of the traces.
+*
+* stencil: 2D halo exchange with the four neighbours in a periodic grid of tasks.
+* fft: all-to-all transposition by pairwise exchange, in P-1 steps.
+* allreduce: dissemination exchange, in ceil(log2 P) steps.
+*
+* In each iteration the tasks compute for #kernel_cpu cycles and then communicate.
+* This file is only used when compiling with TRACE_SUPPORT != 0
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <math.h>
+
+#include "globals.h"
+
+#if (TRACE_SUPPORT != 0)
+
+/**
+* The state of the kernel in a node.
+*/
+typedef struct kernel_node {
+	long task;	///< The task mapped in this node, or -1 if there is none.
+	long inst;	///< The instance of the task.
+	long iter;	///< The current iteration.
+	long step;	///< The next step of the current iteration. Step 0 is the computation.
+} kernel_node;
+
+static kernel_node *kn=NULL;	///< The kernel state of each node.
+static long kernel_steps;		///< Number of communication steps in each iteration.
+static long grid_x;				///< Width of the grid of tasks in the stencil kernel.
+
+/**
+* Initializes the kernel state of all the nodes, once the tasks have been placed.
+*/
+void init_kernel(){
+	long i, t, inst, P=trace_nodes;
+
+	kn=alloc(nprocs*sizeof(kernel_node));
+	for (i=0; i<nprocs; i++){
+		kn[i].task=-1;
+		kn[i].inst=0;
+	}
+	for (t=0; t<trace_nodes; t++)
+		for (inst=0; inst<trace_instances; inst++){
+			kn[translation[t][inst]].task=t;
+			kn[translation[t][inst]].inst=inst;
+		}
+	rewind_kernel();
+
+	switch (kernel){
+		case STENCIL_KERNEL:
+			for (grid_x=(long)sqrt(P); P%grid_x; grid_x--)
+				;
+			kernel_steps=1;
+			break;
+		case FFT_KERNEL:
+			kernel_steps=P-1;
+			break;
+		case ALLREDUCE_KERNEL:
+			for (kernel_steps=0; (1L<<kernel_steps)<P; kernel_steps++)
+				;
+			break;
+		default:
+			panic("Undefined kernel");
+			break;
+	}
+}
+
+/**
+* Restarts the kernel in all the nodes from the first iteration.
+*/
+void rewind_kernel(){
+	long i;
+
+	for (i=0; i<nprocs; i++){
+		kn[i].iter=0;
+		kn[i].step=0;
+	}
+}
+
+/**
+* Inserts a sent and a reception of a kernel message in a node.
+*
+* @param i The node.
+* @param to The task to send the message to, or -1 for no sent.
+* @param from The task to receive the message from, or -1 for no reception.
+*/
+static void kernel_msg(long i, long to, long from){
+	event ev;
+
+	ev.task=kn[i].iter;
+	ev.count=0;
+	ev.length=(long)ceil((double)max(kernel_bytes, 1)/(pkt_len*phit_len));
+	if (to>=0 && to!=kn[i].task){
+		ev.type=rdv_send_type(kernel_bytes, B_FALSE, B_FALSE);
+		ev.pid=translation[to][kn[i].inst];
+		ins_event(&network[i].events, ev);
+	}
+	if (from>=0 && from!=kn[i].task){
+		ev.type=RECEPTION;
+		ev.pid=translation[from][kn[i].inst];
+		ins_event(&network[i].events, ev);
+	}
+}
+
+/**
+* Inserts the events of the next step of the kernel in a node.
+*
+* Called when the event queue of the node becomes empty.
+*
+* @param i The node.
+* @return TRUE if some event has been inserted, FALSE if the kernel has finished in this node.
+*/
+bool_t kernel_next(long i){
+	event ev;
+	long r, P=trace_nodes, x, y, s;
+
+	if (kn==NULL || kn[i].task<0)
+		return B_FALSE;
+	r=kn[i].task;
+	while (kn[i].iter<kernel_iters && event_empty(&network[i].events)){
+		s=kn[i].step++;
+		if (s==0){
+			if (kernel_cpu>0){
+				ev.type=COMPUTATION;
+				ev.pid=0;
+				ev.task=0;
+				ev.length=kernel_cpu;
+				ev.count=0;
+				ins_event(&network[i].events, ev);
+			}
+		}
+		else {
+			switch (kernel){
+				case STENCIL_KERNEL:
+					x=r%grid_x;
+					y=r/grid_x;
+					kernel_msg(i, y*grid_x+mod(x+1, grid_x), y*grid_x+mod(x-1, grid_x));
+					kernel_msg(i, y*grid_x+mod(x-1, grid_x), y*grid_x+mod(x+1, grid_x));
+					kernel_msg(i, mod(y+1, P/grid_x)*grid_x+x, mod(y-1, P/grid_x)*grid_x+x);
+					kernel_msg(i, mod(y-1, P/grid_x)*grid_x+x, mod(y+1, P/grid_x)*grid_x+x);
+					break;
+				case FFT_KERNEL:
+					kernel_msg(i, (r+s)%P, mod(r-s, P));
+					break;
+				case ALLREDUCE_KERNEL:
+					kernel_msg(i, (r+(1L<<(s-1)))%P, mod(r-(1L<<(s-1)), P));
+					break;
+				default:
+					break;
+			}
+		}
+		if (s==kernel_steps){
+			kn[i].iter++;
+			kn[i].step=0;
+		}
+	}
+	return !event_empty(&network[i].events);
+}
+
+/**
+* Saves or restores the kernel state of the nodes in a checkpoint.
+*/
+void kernel_checkpoint(){
+	if (kn!=NULL)
+		ckpt_data(kn, nprocs*sizeof(kernel_node));
+}
+#endif /* TRACE_SUPPORT */
@@ -47,6 +47,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 /* Global variables - parameters */
 
 long  r_seed;		///< Random Seed
+bool_t crn;		///< Common random numbers: the traffic of each node is drawn from its own random stream.
 
 double load;		///< The provided injected load.
 double trigger_rate;///< Probability to trigger new packets when a packet is received.
@@ -184,10 +185,53 @@ inj_mode_t inj_mode;
 */
 placement_t placement;
 
+/**
+* Id of the algorithm used to expand the collectives in the traces.
+*
+* @see coll_alg_t
+* @see coll_alg_l
+*/
+coll_alg_t coll_alg;
+
+long eager_threshold;	///< Largest message (in bytes) sent without rendezvous. Negative to send all the messages eagerly.
+double cpu_speed;		///< The cpu speed in Mhz, to translate the cpu bursts of dimemas traces into fsin cycles.
+double op_per_cycle;	///< Balances the computation time (cpu time/op_per_cycle)==fsin cycles.
+double file_time;		///< Delay for accessing a file in dimemas traces.
+double file_scale;		///< Scale for file accesses based on their size in dimemas traces.
+double cpu_scale;		///< Factor applied to the length of all the cpu bursts in traces.
+double *cpu_ratios;		///< CPU/network speed ratios to replay the trace with, one run for each.
+long n_cpu_ratios;		///< Number of CPU/network speed ratios. If 0 the trace is replayed once at the configured speed.
+
+/**
+* Id of the synthetic kernel used instead of a trace file.
+*
+* @see kernel_t
+* @see kernel_l
+*/
+kernel_t kernel;
+
+long kernel_iters;	///< Number of iterations of the kernel.
+long kernel_bytes;	///< Size (in bytes) of the messages of the kernel.
+long kernel_cpu;	///< Cycles of computation in each iteration of the kernel.
+
 long shift;				///< Number of places for shift placement.
 long trace_nodes;		///< Number of tasks in the trace
 long trace_instances;	///< Number of instances of the trace to simulate
 char placefile[128];
+char jobfile[128];		///< File with the jobs to run concurrently. Empty if only one trace is run.
+char joblog[128];		///< File with the jobs arriving along the simulation. Empty if there is no job log.
+char allocation[128];	///< Placement strategy used to allocate the jobs of the log.
+long anneal_steps;		///< Moves of each annealing chain of the placement optimizer. 0 for 100 per task.
+long critical_path;		///< Number of tasks, messages & links listed in the critical path report. 0 disables it.
+char paraver[128];		///< Base name of the paraver files written in trace driven simulation. Empty for none.
+
+noise_t noise;			///< Distribution of the noise added to each cpu burst.
+double noise_mean;		///< Mean of the noise of each cpu burst, as a fraction of its length.
+double slow_fraction;	///< Fraction of the nodes which are slow.
+double slow_factor;		///< Factor applied to the cpu bursts of the slow nodes.
+long daemon_period;		///< Period of the daemon run in each node, 0 for no daemon.
+long daemon_len;		///< Cycles taken by each activation of the daemon.
+long analytic;			///< Analytic pre-pass of the trace: 0 none, 1 before the simulation, 2 instead of it.
 
 bool_t parallel_injection;			///< Allows/Disallows the parallel injection (inject some packets in the same cycle & router).
 
@@ -284,12 +328,17 @@ char *trcfile;
 long samples;			///< Number of samples (batchs or shots) to take from the current Simulation.
 CLOCK_TYPE batch_time;		///< Sampling period.
 long min_batch_size;	///< Minimum number of reception in a batch to save stats.
+double ci_precision;	///< Relative half-width of the confidence intervals to stop taking batches, 0 for a fixed number of batches.
+long ci_max_samples;	///< Maximum number of batches when stopping by precision.
 
 double threshold;		///< Threshold to accept convergency.
 CLOCK_TYPE warm_up_period,	///< Number of 'oblivious' cycles until start convergency asurement simulation.
 	warmed_up;			///< The cycle in wich warming are really finished.
 CLOCK_TYPE conv_period;		///< Convergency estimation sampling period.
 CLOCK_TYPE max_conv_time;		///< Maximum time for Convergency estimation.
+warm_up_t warm_up_mode;		///< How the end of the warm-up is detected.
+results_t results_format;	///< Format of the machine-readable results. Only text for none.
+CLOCK_TYPE truncation;		///< MSER truncation point: the cycle in which the transient is estimated to end.
 
 /* Global variables - other */
 
@@ -315,8 +364,29 @@ double acum_sq_delay = 0.0,		///< Accumulative square delay. (stats)
 	acum_sq_inj_delay = 0.0;	///< Accumulative square injection delay. (stats)
 long max_delay = 0,				///< Maximum delay. (stats)
 	max_inj_delay = 0;			///< Maximum injection delay. (stats)
+hist_t delay_hist,				///< Histogram of the delay. (stats)
+	inj_delay_hist;				///< Histogram of the injection delay. (stats)
+hist_t run_delay_hist,			///< Histogram of the delay of all the batches. (stats)
+	run_inj_delay_hist;			///< Histogram of the injection delay of all the batches. (stats)
+double percentiles[N_PERCENTILES]={0.5, 0.9, 0.99, 0.999};	///< Percentiles reported.
+
+double sat_tolerance;	///< Width of the interval of the saturation search, 0 for no search.
+CLOCK_TYPE sat_probe;	///< Length of the warm-up & the measurement of each probe of the saturation search.
+double sat_load;		///< Saturation load found.
+long sat_probes;		///< Number of probes run in the saturation search.
+
+char sweep_file[128];	///< File with the grid of parameters to sweep. Empty for a single simulation.
+long sweep_workers;		///< Number of simulations of the sweep run concurrently, 0 for one per core.
+double sat_fractions[N_SAT_FRACTIONS]={0.25, 0.5, 0.75, 0.9};	///< Fractions of the saturation load in which a batch is taken.
 double acum_hops = 0.0;			///< Accumulative number of hops. (stats)
 
+char ckpt_file[128];	///< File to write the checkpoints to. Empty for no checkpoints.
+CLOCK_TYPE ckpt_period;	///< Cycles between checkpoints, 0 to take them only when interrupted.
+char restore_file[128];	///< Checkpoint to restore the simulation from. Empty to start from scratch.
+char rng_state[128];	///< State of the random number generator, kept to save it in the checkpoints.
+
+char fork_file[128];	///< File with the policy variants to fork from the warm network. Empty for none.
+
 batch_t * batch;		///< Array to save all the batchs' stats.
 
 /**
@@ -344,8 +414,9 @@ long aload,		///< Provided load multiplied by RAND_MAX used in injection.
 	 lm_load,	///< Actual long message load multiplied by RAND_MAX used in bimodal injection.
 	 trigger;	///< Provided trigger_rate multiplied by RAND_MAX used in reactive traffic.
 
-long **destinations;	///< Matrix containing map of source/destination pairs at consumption (destination).
-long **sources;			///< Matrix containing map of source/destination pairs at injection (source).
+tmap_t destinations;	///< Map of source/destination pairs at consumption (destination).
+tmap_t sources;			///< Map of source/destination pairs at injection (source).
+long map_sketch;		///< Counters in each row of the sketch approximating the maps, 0 for exact maps.
 long * con_dst;			///< Histograms of distance at consumption (source).
 long * inj_dst;			///< Histograms of distance at injection (source).
 long max_dst;			///< Size of distance histograms.
@@ -555,28 +626,15 @@ void interrupt_handler(int signal) {
 }
 
 /**
-* Main function.
+* Runs a simulation with the current configuration.
 *
 * Initializes the simulation & the network.
 * Then runs the simulation & writes the results.
-*
-* @param argc The number of parameters given in the command line.
-* @param argv Array that constains all the parameters.
-* @return The finalization code. Usually 0.
 */
-int main(int argc, char *argv[]) {
-
-    struct sigaction act;
-
-    act.sa_handler = interrupt_handler;
-    sigaction(SIGINT, &act, NULL);
-    sigaction(SIGTERM, &act, NULL);
-
-	time(&start_time);
-	get_conf((long)(argc - 1), argv + 1);
+void simulate(void) {
 	sim_clock = (CLOCK_TYPE) 1L; // HAS TO BE ONE for arbitrate to work
 
-	srand(r_seed);
+	initstate((unsigned)r_seed, rng_state, sizeof(rng_state));	// Same sequence as srand(r_seed).
 
 	router_init();
 	pkt_init();
@@ -587,12 +645,43 @@ int main(int argc, char *argv[]) {
 	init_network();
 	init_injection();
 
+	if (restore_file[0] != '\0')
+		read_checkpoint();
+
 	if (pheaders > 0)
 		print_headers();
 
 	run_network();
 	time(&end_time);
 	print_results(start_time, end_time);
+	write_results(start_time, end_time);
+}
+
+/**
+* Main function.
+*
+* Gets the configuration & runs the simulation, or the sweep of simulations.
+*
+* @param argc The number of parameters given in the command line.
+* @param argv Array that constains all the parameters.
+* @return The finalization code. Usually 0.
+*/
+int main(int argc, char *argv[]) {
+
+    struct sigaction act;
+
+    act.sa_handler = interrupt_handler;
+    sigaction(SIGINT, &act, NULL);
+    sigaction(SIGTERM, &act, NULL);
+
+	time(&start_time);
+	get_conf((long)(argc - 1), argv + 1);
+#ifndef WIN32
+	if (sweep_file[0] != '\0')
+		run_sweep((long)(argc - 1), argv + 1);
+	else
+#endif
+		simulate();
 #ifdef WIN32
 	system("PAUSE");
 #endif
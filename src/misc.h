@@ -200,9 +200,44 @@ typedef enum inj_mode_t {
 * Definition of task placement types for trace driven.
 */
 typedef enum placement_t{
-	CONSECUTIVE_PLACE, SHUFFLE_PLACE, RANDOM_PLACE, SHIFT_PLACE, ROW_PLACE, COLUMN_PLACE, QUADRANT_PLACE, ICUBE_PLACE, DIAGONAL_PLACE, CIRC_PLACE, FILE_PLACE
+	CONSECUTIVE_PLACE, SHUFFLE_PLACE, RANDOM_PLACE, SHIFT_PLACE, ROW_PLACE, COLUMN_PLACE, QUADRANT_PLACE, ICUBE_PLACE, DIAGONAL_PLACE, CIRC_PLACE, FILE_PLACE, OPT_PLACE
 } placement_t;
 
+/**
+* Definition of the algorithms used to expand the collectives in trace driven.
+*/
+typedef enum coll_alg_t{
+	NO_COLL, BINOMIAL_COLL, RING_COLL, RDOUBLING_COLL, PAIRWISE_COLL
+} coll_alg_t;
+
+/**
+* Definition of the synthetic kernels for trace driven.
+*/
+typedef enum kernel_t{
+	NO_KERNEL, STENCIL_KERNEL, FFT_KERNEL, ALLREDUCE_KERNEL
+} kernel_t;
+
+/**
+* Ways of detecting the end of the warm-up of the synthetic traffic simulations.
+*/
+typedef enum warm_up_t{
+	FIXED_WARM_UP, MSER_WARM_UP
+} warm_up_t;
+
+/**
+* Formats of the machine-readable results, besides the report in the standard output.
+*/
+typedef enum results_t{
+	TEXT_RESULTS, JSON_RESULTS, CSV_RESULTS
+} results_t;
+
+/**
+* Distributions of the noise added to each cpu burst in trace driven simulation.
+*/
+typedef enum noise_t{
+	NO_NOISE, UNIFORM_NOISE, EXP_NOISE
+} noise_t;
+
 /**
 * Definition of the source type for trace driven.
 */
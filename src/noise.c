@@ -0,0 +1,153 @@
+/**
+* @file
+* @brief	OS noise & compute jitter for trace driven simulation.
+*
+* The length of the cpu bursts can be perturbed by three models, which can be combined:
+*
+* burst noise: each burst is lengthened by a random fraction of its length, uniform in [0, 2*mean] or
+* exponential with the given mean.
+* slow nodes: a fraction of the nodes run all their bursts slower, by a given factor.
+* daemons: each node runs a daemon every given period (with a random phase per node) which takes the
+* cpu for some cycles. The bursts are lengthened by the daemon activations occurring during them.
+*
+* The random numbers are taken from a stream per node, seeded from the random seed, so the noise of a node
+* does not depend on the rest of the simulation and it is the same in all the replays of a trace.
+* This file is only used when compiling with TRACE_SUPPORT != 0
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <math.h>
+
+#include "globals.h"
+
+#if (TRACE_SUPPORT != 0)
+
+static unsigned long long *stream=NULL;	///< State of the random stream of each node.
+static bool_t *slow=NULL;			///< Whether each node is slow.
+static CLOCK_TYPE *phase=NULL;		///< Cycle of the first daemon activation in each node.
+
+CLOCK_TYPE noise_cycles=0;	///< Cycles added to the cpu bursts by the noise.
+
+/**
+* Gets the next random number of a stream (splitmix64).
+*
+* @param s The state of the stream.
+* @return A random number in [0, 1).
+*/
+static double next_rand(unsigned long long *s){
+	unsigned long long z=(*s+=0x9E3779B97F4A7C15ULL);
+
+	z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+	z=(z^(z>>27))*0x94D049BB133111EBULL;
+	z^=z>>31;
+	return (z>>11)*(1.0/9007199254740992.0);
+}
+
+/**
+* Starts the random streams of the nodes, and selects the slow nodes & the daemon phases.
+*
+* Called before each replay of the trace, so all the replays get the same noise.
+*/
+void init_noise(){
+	unsigned long long s;
+	long i, j, t, n_slow, *order;
+
+	if (noise==NO_NOISE && slow_fraction<=0.0 && daemon_period<=0)
+		return;
+	if (stream==NULL){
+		stream=alloc(nprocs*sizeof(unsigned long long));
+		slow=alloc(nprocs*sizeof(bool_t));
+		phase=alloc(nprocs*sizeof(CLOCK_TYPE));
+	}
+	noise_cycles=0;
+	s=(unsigned long long)r_seed;
+	order=alloc(nprocs*sizeof(long));
+	for (i=0; i<nprocs; i++){
+		order[i]=i;
+		slow[i]=B_FALSE;
+		stream[i]=(unsigned long long)r_seed*0x100000001B3ULL+i;
+		phase[i]=(daemon_period>0)? sim_clock+(CLOCK_TYPE)(next_rand(&stream[i])*daemon_period) : 0;
+	}
+	n_slow=(long)floor(slow_fraction*nprocs+0.5);
+	for (i=0; i<n_slow && i<nprocs; i++){	// Partial shuffle.
+		j=i+(long)(next_rand(&s)*(nprocs-i));
+		t=order[i];
+		order[i]=order[j];
+		order[j]=t;
+		slow[order[i]]=B_TRUE;
+	}
+	free(order);
+}
+
+/**
+* Gets the number of daemon activations of a node before a cycle.
+*/
+static CLOCK_TYPE daemons_before(long i, CLOCK_TYPE t){
+	if (t<=phase[i])
+		return 0;
+	return (t-phase[i]-1)/daemon_period+1;
+}
+
+/**
+* Applies the noise to a cpu burst.
+*
+* @param i The node.
+* @param start The first cycle of the burst.
+* @param len The length of the burst without noise.
+* @return The length of the burst with noise.
+*/
+CLOCK_TYPE cpu_noise(long i, CLOCK_TYPE start, CLOCK_TYPE len){
+	double l=(double)len;
+	CLOCK_TYPE n0, n=0, m, res;
+
+	if (stream==NULL || len<=0)
+		return len;
+	if (slow[i])
+		l*=slow_factor;
+	switch (noise){
+		case UNIFORM_NOISE:
+			l+=2.0*noise_mean*l*next_rand(&stream[i]);
+			break;
+		case EXP_NOISE:
+			l+=-log(1.0-next_rand(&stream[i]))*noise_mean*l;
+			break;
+		default:
+			break;
+	}
+	res=(CLOCK_TYPE)ceil(l);
+	if (daemon_period>0){	// The activations during the burst lengthen it, so more activations may fall in it.
+		n0=daemons_before(i, start);
+		while ((m=daemons_before(i, start+res+n*daemon_len)-n0)>n)
+			n=m;
+		res+=n*daemon_len;
+	}
+	noise_cycles+=res-len;
+	return res;
+}
+
+/**
+* Saves or restores the random streams of the noise in a checkpoint.
+*/
+void noise_checkpoint(){
+	CKPT(noise_cycles);
+	if (stream==NULL)
+		return;
+	ckpt_data(stream, nprocs*sizeof(unsigned long long));
+	ckpt_data(slow, nprocs*sizeof(bool_t));
+	ckpt_data(phase, nprocs*sizeof(CLOCK_TYPE));
+}
+#endif /* TRACE_SUPPORT */
@@ -0,0 +1,499 @@
+/**
+* @file
+* @brief	Machine-readable results of a simulation.
+*
+* Besides the report in the standard output, the configuration, the summary & the stats of every batch
+* are written to <output>.json, or to <output>.params.csv & <output>.csv (a row for each batch).
+* The maps & histograms of the .map & .hst files are written to the binary sidecar <output>.bin, in
+* native byte order. The maps of sources & destinations are sparse, so they are written as (row, column,
+* value) int64 triplets of their nonzero elements (coo layout); the rest are row-major matrices (dense
+* layout). Each matrix is described by its name, type of the values (int64 or float64), layout, rows,
+* columns, entries (elements or triplets) & offset in the sidecar.
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "globals.h"
+
+#define MAX_MATRICES 8	///< Maximum number of matrices in the sidecar.
+
+static FILE *out;		///< The file being written: json or params csv.
+static bool_t json;		///< Whether the results are written in json (or csv).
+static char *section;	///< The section (json object) being written.
+static long n_fields;	///< Fields written in the current json object.
+
+/**
+* A matrix written to the sidecar.
+*/
+typedef struct matrix_t {
+	char *name;		///< The name of the matrix.
+	char *type;		///< The type of the values: int64 or float64.
+	char *layout;	///< How it is written: dense (row-major) or coo (row, column & value triplets).
+	long rows;		///< The number of rows.
+	long cols;		///< The number of columns.
+	long entries;	///< The elements written (dense) or the triplets (coo).
+	long offset;	///< The offset of the matrix in the sidecar, in bytes.
+} matrix_t;
+
+static matrix_t matrix[MAX_MATRICES];	///< The matrices written to the sidecar.
+static long n_matrices=0;				///< The number of matrices in the sidecar.
+
+/**
+* Writes a string as a json string, escaping the quotes & backslashes.
+*
+* @param s The string.
+*/
+static void write_string(char *s){
+	if (!json){
+		fprintf(out, "%s", s);
+		return;
+	}
+	fputc('"', out);
+	for (; *s; s++){
+		if (*s=='"' || *s=='\\')
+			fputc('\\', out);
+		fputc(*s, out);
+	}
+	fputc('"', out);
+}
+
+/**
+* Starts a field, writing its name.
+*
+* @param name The name of the field.
+*/
+static void field(char *name){
+	if (json)
+		fprintf(out, "%s\n    \"%s\": ", (n_fields++)? "," : "", name);
+	else
+		fprintf(out, "%s,%s,", section, name);
+}
+
+/**
+* Writes a field with a string value.
+*
+* @param name The name of the field.
+* @param v The value.
+*/
+static void field_str(char *name, char *v){
+	field(name);
+	write_string(v);
+	if (!json)
+		fputc('\n', out);
+}
+
+/**
+* Writes a field with an integer value.
+*
+* @param name The name of the field.
+* @param v The value.
+*/
+static void field_long(char *name, long long v){
+	field(name);
+	fprintf(out, (json)? "%lld" : "%lld\n", v);
+}
+
+/**
+* Writes a field with a real value.
+*
+* @param name The name of the field.
+* @param v The value.
+*/
+static void field_double(char *name, double v){
+	field(name);
+	fprintf(out, (json)? "%.10g" : "%.10g\n", v);
+}
+
+/**
+* Starts a section of fields: a json object or the rows with this section in the params csv.
+*
+* @param name The name of the section.
+*/
+static void begin_section(char *name){
+	section=name;
+	n_fields=0;
+	if (json)
+		fprintf(out, "  \"%s\": {", name);
+}
+
+/**
+* Ends a section of fields.
+*/
+static void end_section(void){
+	if (json)
+		fprintf(out, "\n  },\n");
+}
+
+/**
+* Writes the configuration of the simulation.
+*/
+static void write_parameters(void){
+	char *s;
+
+	begin_section("parameters");
+	literal_name(topology_l, &s, topo);
+	field_str("topo", s);
+	field_long("nodes_x", nodes_x);
+	field_long("nodes_y", nodes_y);
+	field_long("nodes_z", nodes_z);
+	field_long("ndim", ndim);
+	field_long("nways", nways);
+	field_long("nodes", NUMNODES);
+	field_long("nprocs", nprocs);
+	field_long("radix", radix);
+	field_long("faults", faults);
+	field_long("nchan", nchan);
+	field_long("ninj", ninj);
+	field_long("tql", tr_ql-1);
+	field_long("iql", inj_ql-1);
+	literal_name(vc_l, &s, vc_management);
+	field_str("vc", s);
+	literal_name(routing_l, &s, routing);
+	field_str("routing", s);
+	literal_name(rmode_l, &s, req_mode);
+	field_str("rmode", s);
+	literal_name(atype_l, &s, arb_mode);
+	field_str("amode", s);
+	literal_name(ctype_l, &s, cons_mode);
+	field_str("cmode", s);
+	literal_name(injmode_l, &s, inj_mode);
+	field_str("imode", s);
+	field_long("bub", bub_adap[1]);
+	field_long("bub_x", bub_x);
+	field_long("bub_y", bub_y);
+	field_long("bub_z", bub_z);
+	field_long("par_inj", parallel_injection);
+	field_long("drop_packets", drop_packets);
+	field_long("extract", extract);
+	field_double("global_cc", global_cc);
+	field_long("update_period", update_period);
+	field_double("intransit_pr", intransit_pr);
+	field_long("timeout_upper_limit", timeout_upper_limit);
+	field_long("timeout_lower_limit", timeout_lower_limit);
+	literal_name(pattern_l, &s, pattern);
+	field_str("tpattern", s);
+	if (pattern == TRACE)
+		field_str("tracefile", trcfile);
+	field_double("load", load);
+	field_long("plength", pkt_len);
+	field_long("phit_len", phit_len);
+	field_double("trigger_rate", trigger_rate);
+	field_long("trigger_min", trigger_min);
+	field_long("trigger_max", trigger_max);
+	field_long("shotmode", shotmode);
+	field_long("shotsize", shotsize);
+	field_long("rseed", r_seed);
+	field_long("crn", crn);
+	literal_name(warm_up_l, &s, warm_up_mode);
+	field_str("warm_up_mode", s);
+	field_long("warm_up_period", warm_up_period);
+	field_long("max_conv_time", max_conv_time);
+	field_long("conv_period", conv_period);
+	field_double("conv_thres", threshold);
+	field_long("batch_time", batch_time);
+	field_long("min_batch_pkt", min_batch_size);
+	field_double("precision", ci_precision);
+	field_long("precision_max_samples", ci_max_samples);
+	field_double("sat_tolerance", sat_tolerance);
+	field_long("sat_probe", sat_probe);
+	field_long("plevel", plevel);
+	field_long("map_sketch", map_sketch);
+	end_section();
+}
+
+/**
+* Writes the summary of the simulation.
+*
+* @param start_time The time the simulation started.
+* @param end_time The time the simulation finished.
+*/
+static void write_summary(time_t start_time, time_t end_time){
+	char name[32];
+	long i;
+
+	begin_section("results");
+	field_str("status", (interrupted)? "interrupted" : (aborted)? "aborted" : "completed");
+	field_long("cycles", sim_clock);
+	field_long("seconds", (long)(end_time-start_time));
+	field_long("batches", reseted);
+	field_long("warmed_up", warmed_up);
+	field_long("truncation", truncation);
+	if (sat_tolerance > 0.0){
+		field_double("sat_load", sat_load);
+		field_long("sat_probes", sat_probes);
+	}
+	for (i=0; i<N_PERCENTILES; i++){
+		sprintf(name, "delay_p%g", 100.0*percentiles[i]);
+		field_double(name, hist_percentile(&run_delay_hist, percentiles[i]));
+	}
+	for (i=0; i<N_PERCENTILES; i++){
+		sprintf(name, "inj_delay_p%g", 100.0*percentiles[i]);
+		field_double(name, hist_percentile(&run_inj_delay_hist, percentiles[i]));
+	}
+	end_section();
+}
+
+/**
+* Writes the stats of a batch: a json object or a csv row.
+*
+* @param f The file.
+* @param i The number of the batch.
+* @param b The batch.
+*/
+static void write_batch(FILE *f, long i, batch_t *b){
+	long p;
+
+	fprintf(f, (json)? "    {\"batch\": %ld, \"clock\": %lld, \"avDist\": %.10g, " : "%ld,%lld,%.10g,",
+			i, (long long)b->clock, b->avDist);
+	fprintf(f, (json)? "\"sent_count\": %.10g, \"rcvd_count\": %.10g, \"dropped_count\": %.10g, " : "%.10g,%.10g,%.10g,",
+			b->sent_count, b->rcvd_count, b->dropped_count);
+	fprintf(f, (json)? "\"sent_phit_count\": %.10g, \"rcvd_phit_count\": %.10g, \"dropped_phit_count\": %.10g, " : "%.10g,%.10g,%.10g,",
+			b->sent_phit_count, b->rcvd_phit_count, b->dropped_phit_count);
+	fprintf(f, (json)? "\"inj_load\": %.10g, \"acc_load\": %.10g, " : "%.10g,%.10g,", b->inj_load, b->acc_load);
+	fprintf(f, (json)? "\"avg_delay\": %.10g, \"stDev_delay\": %.10g, \"max_delay\": %ld, " : "%.10g,%.10g,%ld,",
+			b->avg_delay, b->stDev_delay, b->max_delay);
+	fprintf(f, (json)? "\"avg_inj_delay\": %.10g, \"stDev_inj_delay\": %.10g, \"max_inj_delay\": %ld" : "%.10g,%.10g,%ld",
+			b->avg_inj_delay, b->stDev_inj_delay, b->max_inj_delay);
+	for (p=0; p<N_PERCENTILES; p++)
+		if (json)
+			fprintf(f, ", \"delay_p%g\": %.10g", 100.0*percentiles[p], b->pct_delay[p]);
+		else
+			fprintf(f, ",%.10g", b->pct_delay[p]);
+	for (p=0; p<N_PERCENTILES; p++)
+		if (json)
+			fprintf(f, ", \"inj_delay_p%g\": %.10g", 100.0*percentiles[p], b->pct_inj_delay[p]);
+		else
+			fprintf(f, ",%.10g", b->pct_inj_delay[p]);
+	fprintf(f, (json)? "}" : "\n");
+}
+
+/**
+* Writes the stats of all the batches.
+*/
+static void write_batches(void){
+	char name[256];
+	FILE *f=out;
+	long i, p;
+
+	if (json)
+		fprintf(f, "  \"batches\": [");
+	else {
+		sprintf(name, "%s.csv", file);
+		if ((f=fopen(name, "w"))==NULL){
+			printf("WARNING: cannot create batches csv file\n");
+			return;
+		}
+		fprintf(f, "batch,clock,avDist,sent_count,rcvd_count,dropped_count,sent_phit_count,rcvd_phit_count,dropped_phit_count,"
+				"inj_load,acc_load,avg_delay,stDev_delay,max_delay,avg_inj_delay,stDev_inj_delay,max_inj_delay");
+		for (p=0; p<N_PERCENTILES; p++)
+			fprintf(f, ",delay_p%g", 100.0*percentiles[p]);
+		for (p=0; p<N_PERCENTILES; p++)
+			fprintf(f, ",inj_delay_p%g", 100.0*percentiles[p]);
+		fprintf(f, "\n");
+	}
+	for (i=0; i<reseted; i++){
+		if (json)
+			fprintf(f, (i)? ",\n" : "\n");
+		write_batch(f, i, &batch[i]);
+	}
+	if (json)
+		fprintf(f, "\n  ],\n");
+	else
+		fclose(f);
+}
+
+/**
+* Starts a matrix in the sidecar.
+*
+* @param name The name of the matrix.
+* @param type The type of the values: int64 or float64.
+* @param layout How it is written: dense or coo.
+* @param rows The number of rows.
+* @param cols The number of columns.
+* @param entries The elements (dense) or triplets (coo) written.
+* @param offset The offset of the matrix in the sidecar.
+*/
+static void add_matrix(char *name, char *type, char *layout, long rows, long cols, long entries, long offset){
+	if (n_matrices == MAX_MATRICES)
+		panic("Too many matrices in the results sidecar");
+	matrix[n_matrices].name=name;
+	matrix[n_matrices].type=type;
+	matrix[n_matrices].layout=layout;
+	matrix[n_matrices].rows=rows;
+	matrix[n_matrices].cols=cols;
+	matrix[n_matrices].entries=entries;
+	matrix[n_matrices].offset=offset;
+	n_matrices++;
+}
+
+/**
+* Writes a row of integers to the sidecar.
+*
+* @param f The sidecar.
+* @param v The values.
+* @param n The number of values.
+*/
+static void write_longs(FILE *f, long *v, long n){
+	long long x;
+	long i;
+
+	for (i=0; i<n; i++){
+		x=v[i];
+		fwrite(&x, sizeof(x), 1, f);
+	}
+}
+
+/**
+* Writes a map of sources & destinations to the sidecar, as triplets of its nonzero elements.
+*
+* @param f The sidecar.
+* @param name The name of the map.
+* @param m The map.
+* @param dst Room for the destinations of a source.
+* @param count Room for the packets to each destination.
+*/
+static void write_map(FILE *f, char *name, tmap_t *m, long *dst, long *count){
+	long i, k, n, entries=0, offset=ftell(f), t[3];
+
+	for (i=0; i<nprocs; i++){
+		n=tmap_pairs(m, i, dst, count);
+		for (k=0; k<n; k++){
+			t[0]=i;
+			t[1]=dst[k];
+			t[2]=count[k];
+			write_longs(f, t, 3);
+		}
+		entries+=n;
+	}
+	add_matrix(name, "int64", "coo", nprocs, nprocs, entries, offset);
+}
+
+/**
+* Writes the maps & histograms of the .map & .hst files to the sidecar.
+*
+* @param copyclock The cycles in which the utilization of the channels was measured.
+*/
+static void write_sidecar(CLOCK_TYPE copyclock){
+	char name[256];
+	FILE *f;
+	long i, e, c, *dst, *count;
+	long long x;
+	double u;
+
+	n_matrices=0;
+	if (!(plevel & 15))
+		return;
+	sprintf(name, "%s.bin", file);
+	if ((f=fopen(name, "wb"))==NULL){
+		printf("WARNING: cannot create results sidecar file\n");
+		return;
+	}
+	if (plevel & 1){
+		dst=alloc(sizeof(long)*nprocs);
+		count=alloc(sizeof(long)*nprocs);
+		write_map(f, "sources", &sources, dst, count);
+		write_map(f, "destinations", &destinations, dst, count);
+		free(dst);
+		free(count);
+	}
+	if (plevel & 2){	// A row for each node, a column for each channel.
+		add_matrix("channel_utilization", "float64", "dense", NUMNODES, p_inj_first, NUMNODES*p_inj_first, ftell(f));
+		for (i=0; i<NUMNODES; i++)
+			for (e=0; e<p_inj_first; e++){
+				u=(copyclock>0)? 1.0*network[i].p[e].utilization/copyclock : 0.0;
+				fwrite(&u, sizeof(u), 1, f);
+			}
+	}
+	if (plevel & 4){	// A row for each distance: injection & consumption.
+		add_matrix("distance", "int64", "dense", max_dst, 2, max_dst*2, ftell(f));
+		for (i=0; i<max_dst; i++){
+			write_longs(f, &inj_dst[i], 1);
+			write_longs(f, &con_dst[i], 1);
+		}
+	}
+	if (plevel & 8){	// A row for each port of each node, a column for each occupancy.
+		add_matrix("port_occupancy", "int64", "dense", NUMNODES*(p_inj_last+1), buffer_cap+1,
+				NUMNODES*(p_inj_last+1)*(buffer_cap+1), ftell(f));
+		for (i=0; i<NUMNODES; i++)
+			for (e=0; e<=p_inj_last; e++)
+				for (c=0; c<=buffer_cap; c++){
+					x=network[i].p[e].histo[c];
+					fwrite(&x, sizeof(x), 1, f);
+				}
+	}
+	fclose(f);
+}
+
+/**
+* Writes the descriptions of the matrices in the sidecar.
+*/
+static void write_matrices(void){
+	char name[256];
+	long m;
+
+	sprintf(name, "%s.bin", file);
+	if (json){
+		fprintf(out, "  \"sidecar\": ");
+		write_string(name);
+		fprintf(out, ",\n  \"matrices\": [");
+		for (m=0; m<n_matrices; m++)
+			fprintf(out, "%s\n    {\"name\": \"%s\", \"type\": \"%s\", \"layout\": \"%s\", \"rows\": %ld, \"cols\": %ld, "
+					"\"entries\": %ld, \"offset\": %ld}", (m)? "," : "", matrix[m].name, matrix[m].type, matrix[m].layout,
+					matrix[m].rows, matrix[m].cols, matrix[m].entries, matrix[m].offset);
+		fprintf(out, "\n  ]\n");
+	}
+	else
+		for (m=0; m<n_matrices; m++)
+			fprintf(out, "matrix,%s,%s %s %s %ld %ld %ld %ld\n", matrix[m].name, name, matrix[m].type, matrix[m].layout,
+					matrix[m].rows, matrix[m].cols, matrix[m].entries, matrix[m].offset);
+}
+
+/**
+* Writes the machine-readable results, when selected with #results_format.
+*
+* Called after print_results(), so #reseted holds the number of batches taken.
+*
+* @param start_time The time the simulation started.
+* @param end_time The time the simulation finished.
+*/
+void write_results(time_t start_time, time_t end_time){
+	char name[256];
+	CLOCK_TYPE copyclock=0;
+	long i;
+
+	if (results_format == TEXT_RESULTS)
+		return;
+	json=(bool_t)(results_format == JSON_RESULTS);
+	sprintf(name, (json)? "%s.json" : "%s.params.csv", file);
+	if ((out=fopen(name, "w"))==NULL){
+		printf("WARNING: cannot create results file\n");
+		return;
+	}
+	for (i=0; i<reseted; i++)
+		copyclock+=batch[i].clock;	// Cycles of the sampling period, as in print_results.
+	if (copyclock == 0)
+		copyclock=sim_clock-last_reset_time;
+
+	fprintf(out, (json)? "{\n" : "section,name,value\n");
+	write_parameters();
+	write_summary(start_time, end_time);
+	write_batches();
+	write_sidecar(copyclock);
+	write_matrices();
+	if (json)
+		fprintf(out, "}\n");
+	fclose(out);
+}
@@ -48,6 +48,12 @@ typedef struct packet_t {
 #if (TRACE_SUPPORT != 0)
 	long task;		///< Task id in event driven simulation
 	long length;	///< Length of a message in event driven simulation
+	long kind;		///< SENDING for data packets, RTS or CTS for the control packets of the rendezvous protocol.
+	long job;		///< Job which sent the packet, -1 for background traffic.
+	CLOCK_TYPE hop_time;	///< Cycle in which the header arrived to its current router.
+	CLOCK_TYPE worst_wait;	///< Longest wait of the header in a router.
+	long worst_node;	///< Router in which the header waited longest, -1 if it has not waited.
+	long worst_port;	///< Output port taken after waiting longest.
 #endif /* TRACE */
 #if (EXECUTION_DRIVEN != 0)
 	long id_trama;	///< Identifier of an Ethernet frame for execution-driven simulation
@@ -0,0 +1,435 @@
+/**
+* @file
+* @brief	Paraver timeline of the simulated tasks in trace driven simulation.
+*
+* Writes #paraver.prv, #paraver.pcf & #paraver.row with the state of each task (running, blocking
+* send or waiting a message) and a communication record for each message, with its logical & physical
+* send and receive times. There is one task (with one thread) per node, and the time is in cycles.
+*
+* The states & messages are taken from the critical path tracking as they finish, so they are not
+* produced in time order. The records are written to a buffer, which is sorted by begin time (the
+* 6th field) and written to a temporary file as a run by a background thread (when
+* PARAVER_THREAD != 0) while the simulation goes on filling another buffer. When closing, the runs
+* are merged into the .prv, after its header, so the records are in time order.
+* This file is only used when compiling with TRACE_SUPPORT != 0
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "globals.h"
+
+#if (TRACE_SUPPORT != 0)
+
+#if (PARAVER_THREAD != 0)
+#include <pthread.h>
+#endif
+
+#define PRV_BUFFER (1<<20)	///< Size of each buffer.
+#define PRV_RECORD 256		///< Maximum length of a record.
+#define PRV_RECORDS (PRV_BUFFER/16)	///< Maximum number of records in a buffer (the shortest has 16 bytes).
+#define PRV_READ (64*PRV_RECORD)	///< Size of the read buffer of each run when merging.
+
+/**
+* Paraver states.
+*/
+#define PRV_RUNNING 1	///< Computing.
+#define PRV_WAITING 3	///< Waiting a message.
+#define PRV_SENDING 4	///< Blocking send.
+
+/**
+* A record in a buffer.
+*/
+typedef struct prv_rec {
+	CLOCK_TYPE time;	///< Begin time of the record.
+	long pos;			///< Position of the record in the buffer.
+	long len;			///< Length of the record.
+} prv_rec;
+
+/**
+* A sorted run in the temporary file, being merged.
+*/
+typedef struct prv_run {
+	long pos;			///< Position of the next byte to read in the temporary file.
+	long end;			///< End of the run in the temporary file.
+	char *data;			///< Read buffer.
+	long first;			///< Position of the current record in the read buffer.
+	long last;			///< Bytes in the read buffer.
+	long len;			///< Length of the current record.
+	CLOCK_TYPE time;	///< Begin time of the current record.
+} prv_run;
+
+static FILE *fprv=NULL;		///< The .prv file.
+static FILE *ftmp=NULL;		///< The temporary file with the sorted runs.
+static long ftime_pos;		///< Position of the final time in the header.
+static char *buf[2];		///< The buffers.
+static prv_rec *recs[2];	///< The records in each buffer.
+static long used=0;			///< Bytes used in the current buffer.
+static long n_recs=0;		///< Records in the current buffer.
+static int cur=0;			///< The buffer being filled.
+static long *run_end=NULL;	///< End of each run in the temporary file.
+static long n_runs=0;		///< Number of runs in the temporary file.
+
+/**
+* Sorts records by begin time, keeping the order in which they were produced.
+*/
+static int cmp_rec(const void *a, const void *b){
+	const prv_rec *x=a, *y=b;
+
+	if (x->time!=y->time)
+		return (x->time>y->time)-(x->time<y->time);
+	return (x->pos>y->pos)-(x->pos<y->pos);
+}
+
+/**
+* Sorts the records of a buffer and writes them to the temporary file as a new run.
+*
+* @param b The buffer.
+* @param n The number of records in the buffer.
+*/
+static void prv_write_run(int b, long n){
+	long r;
+
+	if (n==0)
+		return;
+	qsort(recs[b], n, sizeof(prv_rec), cmp_rec);
+	for (r=0; r<n; r++)
+		fwrite(buf[b]+recs[b][r].pos, 1, recs[b][r].len, ftmp);
+	if ((run_end=realloc(run_end, (n_runs+1)*sizeof(long)))==NULL)
+		panic("Cannot allocate the paraver runs");
+	run_end[n_runs++]=ftell(ftmp);
+}
+
+#if (PARAVER_THREAD != 0)
+static pthread_t writer;			///< The thread writing the buffers.
+static pthread_mutex_t lock=PTHREAD_MUTEX_INITIALIZER;	///< Protects #pending & #finish.
+static pthread_cond_t full=PTHREAD_COND_INITIALIZER;	///< Signals a buffer ready to be written (or #finish).
+static pthread_cond_t empty=PTHREAD_COND_INITIALIZER;	///< Signals that the buffer has been written.
+static long pending=-1;				///< Records in the buffer ready to be written (the other one), -1 if none.
+static bool_t finish=B_FALSE;		///< No more buffers will be written.
+
+/**
+* Writes the buffers to the file as they are filled.
+*/
+static void * prv_writer(void *arg){
+	long n;
+
+	for (;;){
+		pthread_mutex_lock(&lock);
+		while (pending<0 && !finish)
+			pthread_cond_wait(&full, &lock);
+		if (pending<0){
+			pthread_mutex_unlock(&lock);
+			return NULL;
+		}
+		n=pending;
+		pthread_mutex_unlock(&lock);
+
+		prv_write_run(1-cur, n);
+
+		pthread_mutex_lock(&lock);
+		pending=-1;
+		pthread_cond_signal(&empty);
+		pthread_mutex_unlock(&lock);
+	}
+}
+#endif
+
+/**
+* Hands the current buffer to be written, and starts filling the other one.
+*/
+static void prv_flush(){
+#if (PARAVER_THREAD != 0)
+	pthread_mutex_lock(&lock);
+	while (pending>=0)
+		pthread_cond_wait(&empty, &lock);
+	cur=1-cur;	// The writer takes the buffer not being filled.
+	pending=n_recs;
+	pthread_cond_signal(&full);
+	pthread_mutex_unlock(&lock);
+#else
+	prv_write_run(cur, n_recs);
+#endif
+	used=0;
+	n_recs=0;
+}
+
+/**
+* Adds a record to the buffer.
+*
+* @param time The begin time of the record.
+* @param fmt The format of the record, followed by its fields.
+*/
+static void prv_record(CLOCK_TYPE time, char *fmt, ...){
+	va_list ap;
+	prv_rec *r;
+
+	if (used+PRV_RECORD>PRV_BUFFER || n_recs==PRV_RECORDS)
+		prv_flush();
+	r=&recs[cur][n_recs++];
+	r->time=time;
+	r->pos=used;
+	va_start(ap, fmt);
+	r->len=vsnprintf(buf[cur]+used, PRV_RECORD, fmt, ap);
+	va_end(ap);
+	used+=r->len;
+}
+
+/**
+* Moves to the next record of a run, refilling its read buffer if needed.
+*
+* @param r The run.
+* @return FALSE if the run is over.
+*/
+static bool_t prv_next(prv_run *r){
+	long n;
+	char *c;
+
+	r->first+=r->len;
+	if (r->last-r->first<PRV_RECORD && r->pos<r->end){
+		memmove(r->data, r->data+r->first, r->last-r->first);
+		r->last-=r->first;
+		r->first=0;
+		n=(r->end-r->pos<PRV_READ-r->last)? r->end-r->pos : PRV_READ-r->last;
+		fseek(ftmp, r->pos, SEEK_SET);
+		if ((long)fread(r->data+r->last, 1, n, ftmp)!=n)
+			panic("Cannot read the paraver temporary file");
+		r->pos+=n;
+		r->last+=n;
+	}
+	if (r->first==r->last)
+		return B_FALSE;
+	r->len=(char *)memchr(r->data+r->first, '\n', r->last-r->first)-(r->data+r->first)+1;
+	for (c=r->data+r->first, n=0; n<5; c++)	// The begin time is the 6th field.
+		if (*c==':')
+			n++;
+	r->time=strtoll(c, NULL, 10);
+	return B_TRUE;
+}
+
+/**
+* Checks whether the current record of a run goes before the one of another run.
+*/
+static bool_t prv_before(prv_run *runs, long a, long b){
+	return (runs[a].time<runs[b].time || (runs[a].time==runs[b].time && a<b));
+}
+
+/**
+* Moves down a run in the heap of runs being merged.
+*
+* @param runs The runs.
+* @param h The heap, with the index of the runs.
+* @param n The number of runs in the heap.
+* @param i The position of the run to move down.
+*/
+static void prv_sift(prv_run *runs, long *h, long n, long i){
+	long c, t;
+
+	for (; (c=2*i+1)<n; i=c){
+		if (c+1<n && prv_before(runs, h[c+1], h[c]))
+			c++;
+		if (!prv_before(runs, h[c], h[i]))
+			break;
+		t=h[i];
+		h[i]=h[c];
+		h[c]=t;
+	}
+}
+
+/**
+* Merges the sorted runs of the temporary file into the .prv file.
+*/
+static void prv_merge(){
+	prv_run *runs=alloc(n_runs*sizeof(prv_run)), *r;
+	long *h=alloc(n_runs*sizeof(long)), n=0, i;
+
+	for (i=0; i<n_runs; i++){
+		r=&runs[i];
+		r->pos=(i>0)? run_end[i-1] : 0;
+		r->end=run_end[i];
+		r->data=alloc(PRV_READ);
+		r->first=r->last=r->len=0;
+		if (prv_next(r))
+			h[n++]=i;
+	}
+	for (i=n/2-1; i>=0; i--)
+		prv_sift(runs, h, n, i);
+	while (n>0){
+		r=&runs[h[0]];
+		fwrite(r->data+r->first, 1, r->len, fprv);
+		if (!prv_next(r))
+			h[0]=h[--n];
+		prv_sift(runs, h, n, 0);
+	}
+	for (i=0; i<n_runs; i++)
+		free(runs[i].data);
+	free(runs);
+	free(h);
+}
+
+/**
+* Writes the .pcf file with the names of the states.
+*/
+static void write_pcf(char *name){
+	FILE *f;
+
+	if ((f=fopen(name, "w"))==NULL)
+		panic("Cannot write the paraver .pcf file");
+	fprintf(f, "DEFAULT_OPTIONS\n\nLEVEL               THREAD\nUNITS               NANOSEC\n\n");
+	fprintf(f, "STATES\n0    Idle\n%d    Running\n%d    Waiting a message\n%d    Blocking Send\n\n",
+		PRV_RUNNING, PRV_WAITING, PRV_SENDING);
+	fprintf(f, "STATES_COLOR\n0    {117,195,255}\n%d    {0,0,255}\n%d    {255,0,0}\n%d    {255,0,174}\n",
+		PRV_RUNNING, PRV_WAITING, PRV_SENDING);
+	fclose(f);
+}
+
+/**
+* Writes the .row file with the names of the nodes.
+*/
+static void write_row(char *name){
+	FILE *f;
+	long i;
+
+	if ((f=fopen(name, "w"))==NULL)
+		panic("Cannot write the paraver .row file");
+	fprintf(f, "LEVEL CPU SIZE %ld\n", nprocs);
+	for (i=0; i<nprocs; i++)
+		fprintf(f, "node %ld\n", i);
+	fprintf(f, "\nLEVEL NODE SIZE 1\nfsin\n\nLEVEL THREAD SIZE %ld\n", nprocs);
+	for (i=0; i<nprocs; i++)
+		fprintf(f, "task %ld\n", i);
+	fclose(f);
+}
+
+/**
+* Opens the paraver files & writes the header of the .prv. The final time is written when closing.
+*/
+void init_paraver(){
+	char name[140];
+	char date[32];
+	time_t now=time(NULL);
+	long i;
+
+	if (paraver[0]=='\0')
+		return;
+	sprintf(name, "%s.pcf", paraver);
+	write_pcf(name);
+	sprintf(name, "%s.row", paraver);
+	write_row(name);
+	sprintf(name, "%s.prv", paraver);
+	if ((fprv=fopen(name, "w"))==NULL)
+		panic("Cannot write the paraver .prv file");
+
+	strftime(date, 32, "%d/%m/%y at %H:%M", localtime(&now));
+	fprintf(fprv, "#Paraver (%s):", date);
+	ftime_pos=ftell(fprv);
+	fprintf(fprv, "%020"PRINT_CLOCK"_ns:1(%ld):1:%ld(", (CLOCK_TYPE)0, nprocs, nprocs);
+	for (i=0; i<nprocs; i++)
+		fprintf(fprv, (i<nprocs-1)? "1:1," : "1:1)\n");
+
+	if ((ftmp=tmpfile())==NULL)
+		panic("Cannot create the paraver temporary file");
+	buf[0]=alloc(PRV_BUFFER);
+	buf[1]=alloc(PRV_BUFFER);
+	recs[0]=alloc(PRV_RECORDS*sizeof(prv_rec));
+	recs[1]=alloc(PRV_RECORDS*sizeof(prv_rec));
+#if (PARAVER_THREAD != 0)
+	if (pthread_create(&writer, NULL, prv_writer, NULL))
+		panic("Cannot create the paraver writer thread");
+#endif
+}
+
+/**
+* A node has finished a state.
+*
+* @param i The node.
+* @param head The event the node was doing.
+* @param start The cycle in which the event started.
+*/
+void prv_state(long i, event_t head, CLOCK_TYPE start){
+	int s;
+
+	if (fprv==NULL || sim_clock<=start)
+		return;
+	switch (head){
+		case COMPUTATION:
+			s=PRV_RUNNING;
+			break;
+		case RECEPTION:
+			s=PRV_WAITING;
+			break;
+		case SENDING:
+		case RDV_SENDING:
+			s=PRV_SENDING;
+			break;
+		default:
+			return;
+	}
+	prv_record(start, "1:%ld:1:%ld:1:%"PRINT_CLOCK":%"PRINT_CLOCK":%d\n", i+1, i+1, start, sim_clock, s);
+}
+
+/**
+* A message has been received.
+*
+* @param from The node sending.
+* @param to The node receiving.
+* @param tag The tag of the message.
+* @param bytes The size of the message.
+* @param lsend The cycle in which the sent started.
+* @param psend The cycle in which the sent finished.
+* @param lrecv The cycle in which the reception started.
+* @param precv The cycle in which the message arrived.
+*/
+void prv_comm(long from, long to, long tag, long bytes, CLOCK_TYPE lsend, CLOCK_TYPE psend, CLOCK_TYPE lrecv, CLOCK_TYPE precv){
+	if (fprv==NULL)
+		return;
+	prv_record(lsend, "3:%ld:1:%ld:1:%"PRINT_CLOCK":%"PRINT_CLOCK":%ld:1:%ld:1:%"PRINT_CLOCK":%"PRINT_CLOCK":%ld:%ld\n",
+		from+1, from+1, lsend, psend, to+1, to+1, lrecv, precv, bytes, tag);
+}
+
+/**
+* Writes the remaining records, merges the runs and writes the final time, and closes the .prv file.
+*/
+void close_paraver(){
+	if (fprv==NULL)
+		return;
+	prv_flush();
+#if (PARAVER_THREAD != 0)
+	pthread_mutex_lock(&lock);
+	finish=B_TRUE;
+	pthread_cond_signal(&full);
+	pthread_mutex_unlock(&lock);
+	pthread_join(writer, NULL);
+#endif
+	prv_merge();
+	fclose(ftmp);
+	ftmp=NULL;
+	fseek(fprv, ftime_pos, SEEK_SET);
+	fprintf(fprv, "%020"PRINT_CLOCK, sim_clock);
+	fclose(fprv);
+	fprv=NULL;
+	free(buf[0]);
+	free(buf[1]);
+	free(recs[0]);
+	free(recs[1]);
+	free(run_end);
+	run_end=NULL;
+	n_runs=0;
+}
+#endif /* TRACE_SUPPORT */
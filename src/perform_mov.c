@@ -23,6 +23,124 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 static void phit_moved(long i, long n_n, port_type s_p, port_type d_p, phit ph);
 static void drop_transit(long i);
 
+#if (ACTIVE_NODES!=0)
+static bool_t active_only=B_FALSE;	///< When TRUE only the nodes in #act are visited.
+static bool_t bg_active;	///< When TRUE independent sources generate background traffic, so they are always active.
+static long *act;		///< The nodes to visit in the current cycle.
+static char *act_state;	///< For each node: 0 if not in #act, 1 if in #act, 2 if it has to be kept for the next cycle.
+static long n_act=0;	///< The number of nodes in #act.
+
+/**
+* Compares two node ids. Used to sort the active nodes.
+*/
+static int cmp_nodes(const void *a, const void *b){
+	return (*(long *)a > *(long *)b) - (*(long *)a < *(long *)b);
+}
+
+/**
+* Checks whether a node still has some work to do in the next cycle.
+*
+* @param i The node to check.
+* @return TRUE if the node has phits, is sending, has triggered packets or injects background traffic.
+*/
+static bool_t has_work(long i){
+	return (network[i].pcount>0 ||
+			network[i].head==SENDING ||
+			rdv_has_work(i) ||
+			network[i].triggered>0 ||
+			(bg_active && i<nprocs && network[i].source==INDEPENDENT_SOURCE));
+}
+
+/**
+* Initializes the set of active nodes for a trace driven simulation.
+*
+* Visiting only the active nodes is not possible when the ports statistics or the
+* congestion timeouts are used, as they need all the nodes to be visited each cycle.
+*/
+void init_active_nodes(){
+	long i;
+
+	if ((plevel & 8) || timeout_upper_limit>0)
+		return;
+	active_only=B_TRUE;
+	bg_active=(aload>0);
+	act=alloc(NUMNODES*sizeof(long));
+	act_state=alloc(NUMNODES*sizeof(char));
+	for (i=0; i<NUMNODES; i++)
+		act_state[i]=0;
+	for (i=0; i<NUMNODES; i++)
+		if (has_work(i))
+			activate_node(i);
+}
+
+/**
+* Marks a node to be visited in the current cycle (if it has not been visited yet) and in the next one.
+*
+* @param i The node to activate.
+*/
+void activate_node(long i){
+	if (!active_only)
+		return;
+	if (act_state[i]==0)
+		act[n_act++]=i;
+	act_state[i]=2;
+}
+
+/**
+* Gets the number of active nodes.
+*
+* @return The number of nodes to visit, or -1 if all the nodes are visited each cycle.
+*/
+long active_nodes(){
+	return (active_only)? n_act : -1;
+}
+
+/**
+* Gets the nodes to visit in this cycle.
+*
+* The nodes with finished cpu bursts are added, and the nodes are sorted, so they are visited
+* in the same order as when visiting all the nodes.
+*
+* @return The number of nodes to visit.
+*/
+static long nodes_to_visit(){
+	if (!active_only)
+		return NUMNODES;
+	trc_finished_cpus();
+	qsort(act, n_act, sizeof(long), cmp_nodes);
+	return n_act;
+}
+
+/**
+* Removes from the active set the nodes without work, once the cycle has finished.
+*
+* The nodes activated during the cycle are kept for the next one.
+*
+* @param n The number of nodes visited in this cycle.
+*/
+static void update_active_nodes(long n){
+	long a, w=0;
+
+	if (!active_only)
+		return;
+	for (a=0; a<n_act; a++){
+		if (a>=n || act_state[act[a]]==2 || has_work(act[a])){
+			act[w++]=act[a];
+			act_state[act[a]]=1;
+		}
+		else
+			act_state[act[a]]=0;
+	}
+	n_act=w;
+}
+
+#define VISITED_NODE(a) ((active_only)? act[a] : (a))	///< The a-th node to visit.
+#else
+#define nodes_to_visit() (NUMNODES)
+#define update_active_nodes(n)
+#define VISITED_NODE(a) (a)
+#endif /* ACTIVE_NODES */
+
 /**
  * Drops in-transit phits/packets
  *
@@ -43,7 +161,7 @@ void drop_transit(long i){
 		if (network[i].p[s_p].aop == p_drop) {
 			rem_queue(&(network[i].p[s_p].q), &ph);	// Drop
 			dropped_phit_count++;
-#if (PCOUNT!=0)
+#if (PCOUNT!=0 || ACTIVE_NODES!=0)
 			network[i].pcount--;
 #endif
 			if(plevel & 32)
@@ -86,7 +204,7 @@ void consume_single(long i) {
 	q = &(network[i].p[s_p].q);		// Transit queue to get phit from
 	rem_queue(q, &ph);
 	phit_away(i, s_p, ph);
-#if (PCOUNT!=0)
+#if (PCOUNT!=0 || ACTIVE_NODES!=0)
 	network[i].pcount--;
 #endif
 }
@@ -109,7 +227,7 @@ void consume_multiple(long i) {
 			if (i>=nprocs)
 				printf ("WARNING packet consumed in communication element %ld [%ld -> %ld] %ld!!!\n",i,pkt_space[ph.packet].to, pkt_space[ph.packet].from, pkt_space[ph.packet].n_hops );
 			phit_away(i, s_p, ph);
-#if (PCOUNT!=0)
+#if (PCOUNT!=0 || ACTIVE_NODES!=0)
 			network[i].pcount--;
 #endif
 		}
@@ -126,11 +244,15 @@ void consume_multiple(long i) {
 */
 void data_movement_direct(bool_t inject) {
 	long i,	// Node id
+		 a,	// Index of the node in the visiting order
+		 n,	// Number of nodes to visit
 		 e,	// port number
 		 ee;// port requested by port 'e'
 	dim j; way k;
 
-	for (i=0; i<NUMNODES; i++) {
+	n=nodes_to_visit();
+	for (a=0; a<n; a++) {
+		i=VISITED_NODE(a);
 		if (plevel & 8)
 			stats(i);
 		if (inject)
@@ -163,7 +285,8 @@ void data_movement_direct(bool_t inject) {
 #endif
 	}
 
-	for (i=0; i<NUMNODES; i++) {
+	for (a=0; a<n; a++) {
+		i=VISITED_NODE(a);
 #if (PCOUNT!=0)
 		if (network[i].pcount){
 #endif
@@ -175,6 +298,7 @@ void data_movement_direct(bool_t inject) {
 #if (PCOUNT!=0)
 	}
 #endif
+	update_active_nodes(n);
 }
 
 /**
@@ -187,12 +311,16 @@ void data_movement_direct(bool_t inject) {
 */
 void data_movement_indirect(bool_t inject) {
 	long i,		// Node id
+		 a,		// Index of the node in the visiting order
+		 n,		// Number of nodes to visit
 		 e,		// port number
 		 ee;	// port requested by port 'e'
 	long to;
 	dim j;
 
-	for (i=0; i<NUMNODES; i++) {
+	n=nodes_to_visit();
+	for (a=0; a<n; a++) {
+		i=VISITED_NODE(a);
 		if (plevel & 8)
 			stats(i);
 		if (i<nprocs){	// This is a NIC. There are only ports for injection/consumption and 1 output port.
@@ -252,14 +380,17 @@ void data_movement_indirect(bool_t inject) {
 		}
 	}
 
-	to=1;
-	for (i=0; i<NUMNODES; i++) {
+	for (a=0; a<n; a++) {
+		i=VISITED_NODE(a);
 		consume(i);
-		if (i==nprocs)	// This way, in CPU nodes only advance the NIC port.
-			to=radix;	// From nprocs on, to=radix.
+		if (i<nprocs)	// This way, in CPU nodes only advance the NIC port.
+			to=1;
+		else
+			to=radix;
 		for (j=0; j<to; j++)
 			advance(i, j);
 	}
+	update_active_nodes(n);
 }
 /**
 * Advance packets.
@@ -301,10 +432,13 @@ void advance(long n, long p) {
 			d_np= port_address(network[n].nborp[p],l);
 
 			phit_moved(n, n_n, s_p, d_np, ph);
-#if (PCOUNT!=0)
+#if (PCOUNT!=0 || ACTIVE_NODES!=0)
 			network[n].pcount--;
 			network[n_n].pcount++;
 #endif
+#if (ACTIVE_NODES!=0)
+			activate_node(n_n);
+#endif
 
 			if (ph.pclass >= TAIL) {
 				network[n].op_i[p] = (l+1)%nchan;	// Next time assign to another virtual channel
@@ -354,8 +488,9 @@ void phit_away(long i, port_type s_p, phit ph) {
 		del = sim_clock - pkt_space[ph.packet].inj_time;
 		acum_delay += del;
 		acum_sq_delay += del*del;
-		if (rand()<= trigger)
-			network[i].triggered += trigger_min + rand()%trigger_dif;
+		hist_record(&delay_hist, del);
+		if (trigger_rand(i)<= trigger)
+			network[i].triggered += trigger_min + trigger_rand(i)%trigger_dif;
 
 		if (del > max_delay)
 			max_delay = del;
@@ -367,7 +502,7 @@ void phit_away(long i, port_type s_p, phit ph) {
 			source_ports[s_p]++;
 
 		if (plevel & 1)
-			destinations[pkt_space[ph.packet].from][pkt_space[ph.packet].to]++;
+			tmap_add(&destinations, pkt_space[ph.packet].from, pkt_space[ph.packet].to);
 
 #if (BIMODAL_SUPPORT != 0)
 		msg_acum_delay[pkt_space[ph.packet].mtype] += del;
@@ -378,14 +513,23 @@ void phit_away(long i, port_type s_p, phit ph) {
 #endif /* BIMODAL */
 
 #if (TRACE_SUPPORT != 0)
-		if (pattern==TRACE){// Adds Event in an ocurred event's list
+		if (pattern==TRACE && pkt_space[ph.packet].kind!=SENDING) // Control packet of the rendezvous protocol
+			rdv_arrival(i, &pkt_space[ph.packet]);
+		else if (pattern==TRACE){// Adds Event in an ocurred event's list
 			event e;
+			crit_arrival(i, &pkt_space[ph.packet]);
 			e.type=RECEPTION;
 			e.pid=pkt_space[ph.packet].from;
 			e.task=pkt_space[ph.packet].task;
 			e.length=pkt_space[ph.packet].length;
 			ins_occur(&network[i].occurs, e);
 		}
+		if (pattern==TRACE){
+			job_rcvd(pkt_space[ph.packet].job, del);
+#if (ACTIVE_NODES!=0)
+			activate_node(i);
+#endif
+		}
 #endif
 
 #if (EXECUTION_DRIVEN != 0)
@@ -469,6 +613,7 @@ void phit_moved(long i, long n_n, port_type s_p, port_type d_p, phit ph) {
 			del = sim_clock - pkt_space[ph.packet].inj_time;
 			acum_inj_delay += del;
 			acum_sq_inj_delay += del*del;
+			hist_record(&inj_delay_hist, del);
 			if (del > max_inj_delay)
 				max_inj_delay = del;
 #if (BIMODAL_SUPPORT != 0)
@@ -481,6 +626,14 @@ void phit_moved(long i, long n_n, port_type s_p, port_type d_p, phit ph) {
 			if (i == monitored)
 				dest_ports[d_p]++;
 		}/* injection */
+#if (TRACE_SUPPORT != 0)
+		else if (pattern==TRACE && sim_clock-pkt_space[ph.packet].hop_time > pkt_space[ph.packet].worst_wait){
+			pkt_space[ph.packet].worst_wait = sim_clock-pkt_space[ph.packet].hop_time;
+			pkt_space[ph.packet].worst_node = i;
+			pkt_space[ph.packet].worst_port = d_p;
+		}
+		pkt_space[ph.packet].hop_time = sim_clock;
+#endif
 		pkt_space[ph.packet].n_hops++;
 	}/* RR */
 
@@ -96,3 +96,48 @@ unsigned long get_pkt(){
 	return f_pkt[last--];
 }
 
+/**
+* Are all the packets free?
+*
+* @return TRUE if there are no packets in the network nor in the injectors.
+*/
+bool_t pkt_all_free(){
+	return (last==pkt_max-1);
+}
+
+/**
+* Saves or restores the packets in a checkpoint.
+*
+* The routing records of the packets in use are saved after the packets. They have a
+* component for each dimension, plus the number of parallel mesh in the icube routings
+* with several mesh.
+*
+* @see ckpt_data()
+*/
+void pkt_checkpoint(){
+	long i, len=(calc_rr==icube_1mesh_rr || calc_rr==icube_4mesh_rr)? ndim+1 : ndim;
+	bool_t *free_p=alloc(pkt_max*sizeof(bool_t)), has_rr;
+
+	CKPT(last);
+	ckpt_data(f_pkt, pkt_max*sizeof(long));
+	ckpt_data(pkt_space, pkt_max*sizeof(packet_t));
+	for (i=0; i<pkt_max; i++)
+		free_p[i]=B_FALSE;
+	for (i=0; i<=last; i++)
+		free_p[f_pkt[i]]=B_TRUE;
+	for (i=0; i<pkt_max; i++){
+		if (free_p[i]){
+			if (!ckpt_saving())
+				pkt_space[i].rr.rr=NULL;
+			continue;
+		}
+		has_rr=(bool_t)(pkt_space[i].rr.rr!=NULL);
+		CKPT(has_rr);
+		if (!has_rr)
+			continue;
+		if (!ckpt_saving())
+			pkt_space[i].rr.rr=alloc(len*sizeof(long));
+		ckpt_data(pkt_space[i].rr.rr, len*sizeof(long));
+	}
+	free(free_p);
+}
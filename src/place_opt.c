@@ -0,0 +1,607 @@
+/**
+* @file
+* @brief	Communication-aware placement of the tasks of a trace.
+*
+* The trace is read once with the tasks placed consecutively, to get the volume of data
+* sent between each pair of tasks. Then the tasks are mapped onto the nodes minimizing the
+* hop-bytes (the bytes of each message times the hops between its end nodes): first with a
+* greedy mapping, which places next the task with more traffic with the already placed ones in
+* the free node closer to them; then with simulated annealing, swapping tasks between nodes.
+* Several annealing chains (#PLACE_THREADS) are run in parallel and the best mapping is kept.
+*
+* The mapping is written to #placefile in the format read by the file placement, so it can be
+* reused without optimizing again, and the trace is read again with the tasks in their new nodes.
+* This file is only used when compiling with TRACE_SUPPORT != 0
+*
+* When PLACE_THREADS != 0 it must be linked with -lpthread.
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "globals.h"
+
+#if (TRACE_SUPPORT != 0)
+
+#if (PLACE_THREADS != 0)
+#include <pthread.h>
+#endif
+
+#define PLACE_ANCHORS 8		///< Placed neighbours of a task around which the greedy mapping looks for free nodes.
+#define PLACE_CANDIDATES 8	///< Free nodes tried around each of those neighbours.
+
+/**
+* Volume of data sent between two tasks.
+*/
+typedef struct volume_t {
+	long a;		///< The lower task.
+	long b;		///< The higher task.
+	double w;	///< Bytes sent between both tasks, in any direction.
+} volume_t;
+
+/**
+* An annealing chain.
+*/
+typedef struct anneal_t {
+	long *map;			///< The node of each task.
+	long *inv;			///< The task in each node, or -1 if it is free.
+	double cost;		///< Cost of the mapping, in hop-bytes.
+	unsigned int seed;	///< Seed of the random numbers of the chain.
+} anneal_t;
+
+static long n_tasks;		///< Number of tasks to place: tasks times instances of the trace.
+static long n_steps;		///< Number of moves in each annealing chain.
+
+static volume_t *vol=NULL;	///< The volumes read from the trace, while building the graph.
+static long n_vol=0;		///< Number of volumes in #vol.
+static long max_vol=0;		///< Room for volumes in #vol.
+
+static long *adj_start;		///< First neighbour of each task in #adj_to. The graph is kept in CSR format.
+static long *adj_to;		///< The neighbours of the tasks.
+static double *adj_w;		///< Bytes sent between each task and each of its neighbours.
+
+static unsigned char *hops;	///< Hops from each node to each other plus the hops back (nprocs x nprocs).
+
+static long *net_start;		///< First neighbour of each router in #net_to. The links of the network in CSR format.
+static long *net_to;		///< The routers at the other end of the links.
+static long *bfs_queue;		///< Routers to visit in a breadth-first search of the network.
+static long *bfs_mark;		///< Search in which each router was reached last.
+static long bfs_n=0;		///< Searches done.
+
+/**
+* Sorts volumes by their pair of tasks.
+*/
+static int cmp_volume(const void *x, const void *y){
+	const volume_t *p=x, *q=y;
+
+	if (p->a!=q->a)
+		return (p->a<q->a)? -1 : 1;
+	if (p->b!=q->b)
+		return (p->b<q->b)? -1 : 1;
+	return 0;
+}
+
+/**
+* Merges the volumes of the same pair of tasks.
+*/
+static void merge_volumes(){
+	long i, n=0;
+
+	if (n_vol==0)
+		return;
+	qsort(vol, n_vol, sizeof(volume_t), cmp_volume);
+	for (i=1; i<n_vol; i++){
+		if (vol[i].a==vol[n].a && vol[i].b==vol[n].b)
+			vol[n].w+=vol[i].w;
+		else
+			vol[++n]=vol[i];
+	}
+	n_vol=n+1;
+}
+
+/**
+* Adds the data sent from a node to another one. Called for each sent in the trace.
+*
+* @param from The node sending.
+* @param to The node receiving.
+* @param w The number of bytes.
+*/
+void place_volume(long from, long to, double w){
+	if (from==to)
+		return;
+	if (n_vol==max_vol){
+		merge_volumes();
+		if (2*n_vol>=max_vol){
+			max_vol=2*max_vol+1024;
+			if ((vol=realloc(vol, max_vol*sizeof(volume_t)))==NULL)
+				panic("Not enough memory for the communication volumes");
+		}
+	}
+	vol[n_vol].a=min(from, to);
+	vol[n_vol].b=max(from, to);
+	vol[n_vol++].w=w;
+}
+
+/**
+* Builds the communication graph of the tasks from the volumes.
+*/
+static void build_graph(){
+	long i, *pos;
+
+	merge_volumes();
+	adj_start=alloc((n_tasks+1)*sizeof(long));
+	adj_to=alloc((2*n_vol+1)*sizeof(long));
+	adj_w=alloc((2*n_vol+1)*sizeof(double));
+	pos=alloc((n_tasks+1)*sizeof(long));
+
+	for (i=0; i<=n_tasks; i++)
+		adj_start[i]=0;
+	for (i=0; i<n_vol; i++){
+		adj_start[vol[i].a+1]++;
+		adj_start[vol[i].b+1]++;
+	}
+	for (i=0; i<n_tasks; i++)
+		adj_start[i+1]+=adj_start[i];
+	for (i=0; i<=n_tasks; i++)
+		pos[i]=adj_start[i];
+	for (i=0; i<n_vol; i++){
+		adj_to[pos[vol[i].a]]=vol[i].b;
+		adj_w[pos[vol[i].a]++]=vol[i].w;
+		adj_to[pos[vol[i].b]]=vol[i].a;
+		adj_w[pos[vol[i].b]++]=vol[i].w;
+	}
+	free(pos);
+	free(vol);
+	vol=NULL;
+	n_vol=max_vol=0;
+}
+
+/**
+* Copies the links of the network to #net_start & #net_to, for the breadth-first searches.
+*
+* The searches only follow the links, so a compact copy is much faster than going through the routers.
+*/
+static void init_links(){
+	long i, p, n=0;
+
+	net_start=alloc((NUMNODES+1)*sizeof(long));
+	for (i=0; i<NUMNODES; i++)
+		for (p=0; p<radix; p++)
+			if (network[i].nbor[p]!=NULL_PORT)
+				n++;
+	net_to=alloc((n+1)*sizeof(long));
+	n=0;
+	for (i=0; i<NUMNODES; i++){
+		net_start[i]=n;
+		for (p=0; p<radix; p++)
+			if (network[i].nbor[p]!=NULL_PORT)
+				net_to[n++]=network[i].nbor[p];
+	}
+	net_start[NUMNODES]=n;
+	bfs_queue=alloc(NUMNODES*sizeof(long));
+	bfs_mark=alloc(NUMNODES*sizeof(long));
+	for (i=0; i<NUMNODES; i++)
+		bfs_mark[i]=0;
+}
+
+/**
+* Gets the hops from a node to all the others, with a breadth-first search of the network.
+*
+* @param s The node.
+* @param dist The hops to each router (output).
+*/
+static void bfs_hops(long s, long *dist){
+	long i, k, n, head, tail;
+
+	bfs_n++;
+	bfs_mark[s]=bfs_n;
+	dist[s]=0;
+	bfs_queue[0]=s;
+	for (head=0, tail=1; head<tail; head++){
+		i=bfs_queue[head];
+		for (k=net_start[i]; k<net_start[i+1]; k++)
+			if (bfs_mark[n=net_to[k]]!=bfs_n){
+				bfs_mark[n]=bfs_n;
+				dist[n]=dist[i]+1;
+				bfs_queue[tail++]=n;
+			}
+	}
+	for (i=0; i<nprocs; i++)
+		if (bfs_mark[i]!=bfs_n)
+			dist[i]=LONG_MAX;	// Not connected.
+}
+
+/**
+* Do the hops of the routing of the topology match the distances in the network?
+*
+* They do when the routing is minimal and uses all the links, which is checked from some nodes.
+*
+* @param dist Room for the hops to each router.
+*/
+static bool_t bfs_matches_routing(long *dist){
+	long k, s, d;
+	routing_r r;
+
+	for (k=0; k<8; k++){
+		s=k*nprocs/8;
+		bfs_hops(s, dist);
+		for (d=0; d<nprocs; d++)
+			if (d!=s){
+				r=calc_rr(s, d);
+				free(r.rr);
+				if (r.size!=dist[d])
+					return B_FALSE;
+			}
+	}
+	return B_TRUE;
+}
+
+/**
+* Gets the hops between all the pairs of nodes, using the routing of the topology.
+*
+* When the routing is minimal, the hops are the distances in the network, which are found
+* with a breadth-first search from each node instead of a routing record for each pair.
+*/
+static void init_hops(){
+	long s, d, h, bs, bd, *dist;
+	routing_r r;
+
+	hops=alloc(nprocs*nprocs*sizeof(unsigned char));
+	dist=alloc(NUMNODES*sizeof(long));
+	if (bfs_matches_routing(dist))
+		for (s=0; s<nprocs; s++){
+			bfs_hops(s, dist);
+			for (d=0; d<nprocs; d++){
+				if (dist[d]>255)
+					panic("Too many hops for the placement optimizer");
+				hops[s*nprocs+d]=(unsigned char)dist[d];	// One way, the way back is added below.
+			}
+		}
+	else
+		for (s=0; s<nprocs; s++){
+			hops[s*nprocs+s]=0;
+			for (d=0; d<nprocs; d++)
+				if (d!=s){
+					r=calc_rr(s, d);
+					free(r.rr);
+					if (r.size>255)
+						panic("Too many hops for the placement optimizer");
+					hops[s*nprocs+d]=(unsigned char)r.size;
+				}
+		}
+	free(dist);
+
+	for (bs=0; bs<nprocs; bs+=64)	// In blocks, to add the transposed matrix without missing the cache.
+		for (bd=0; bd<=bs; bd+=64)
+			for (s=bs; s<min(bs+64, nprocs); s++)
+				for (d=bd; d<min(bd+64, s); d++){
+					if ((h=hops[s*nprocs+d]+hops[d*nprocs+s])>255)
+						panic("Too many hops for the placement optimizer");
+					hops[s*nprocs+d]=hops[d*nprocs+s]=(unsigned char)h;
+				}
+}
+
+/**
+* Finds the free nodes nearest to a node, with a breadth-first search of the network.
+*
+* The search stops as soon as enough free nodes are found, so it only visits the
+* neighbourhood of the node while the network is not full.
+*
+* @param from The node to search from.
+* @param inv The task in each node, or -1 if it is free.
+* @param cand The free nodes found (output), nearest first.
+* @param max_cand The number of free nodes wanted.
+* @return The number of free nodes found.
+*/
+static long nearest_free(long from, long *inv, long *cand, long max_cand){
+	long i, k, n, head, tail, found=0;
+
+	bfs_n++;
+	bfs_mark[from]=bfs_n;
+	bfs_queue[0]=from;
+	for (head=0, tail=1; head<tail && found<max_cand; head++){
+		i=bfs_queue[head];
+		if (i<nprocs && inv[i]<0)
+			cand[found++]=i;
+		for (k=net_start[i]; k<net_start[i+1]; k++)
+			if (bfs_mark[n=net_to[k]]!=bfs_n){
+				bfs_mark[n]=bfs_n;
+				bfs_queue[tail++]=n;
+			}
+	}
+	return found;
+}
+
+/**
+* Gets the cost of a mapping, in hop-bytes.
+*/
+static double mapping_cost(long *map){
+	long t, k;
+	double c=0.0;
+
+	for (t=0; t<n_tasks; t++)
+		for (k=adj_start[t]; k<adj_start[t+1]; k++)
+			c+=adj_w[k]*hops[map[t]*nprocs+map[adj_to[k]]];
+	return c/4;	// Each pair is counted twice, and hops go there & back.
+}
+
+/**
+* Maps the tasks greedily.
+*
+* The first task (the one with more traffic) is placed in the most central node. Then, the task with
+* more traffic with the placed ones is placed in the free node which minimizes its hop-bytes with them.
+* Only the #PLACE_CANDIDATES free nodes nearest to each of its #PLACE_ANCHORS heaviest placed
+* neighbours are tried, so each step costs the degree of the task, not the size of the network.
+*
+* @param map The node of each task (output).
+* @param inv The task in each node (output).
+*/
+static void greedy_mapping(long *map, long *inv){
+	double *conn, *total, best, c, aw[PLACE_ANCHORS];
+	long t, k, n, v, last=0, best_n, placed, n_anchors, n_cand, a, j;
+	long anchor[PLACE_ANCHORS], cand[PLACE_ANCHORS*PLACE_CANDIDATES];
+
+	conn=alloc(n_tasks*sizeof(double));
+	total=alloc(n_tasks*sizeof(double));
+	for (t=0; t<n_tasks; t++){
+		map[t]=-1;
+		conn[t]=0.0;
+		total[t]=0.0;
+		for (k=adj_start[t]; k<adj_start[t+1]; k++)
+			total[t]+=adj_w[k];
+	}
+	for (n=0; n<nprocs; n++)
+		inv[n]=-1;
+
+	for (placed=0; placed<n_tasks; placed++){
+		v=-1;
+		for (t=0; t<n_tasks; t++)	// The most connected to the placed ones, or the heaviest.
+			if (map[t]<0 && (v<0 || conn[t]>conn[v] || (conn[t]==conn[v] && total[t]>total[v])))
+				v=t;
+
+		best_n=-1;
+		best=0.0;
+		if (placed==0)		// The most central node.
+			for (n=0; n<nprocs; n++){
+				c=0.0;
+				for (k=0; k<nprocs; k++)
+					c+=hops[n*nprocs+k];
+				if (best_n<0 || c<best){
+					best_n=n;
+					best=c;
+				}
+			}
+		else if (conn[v]==0.0)	// Not connected: next to the last placed.
+			nearest_free(last, inv, &best_n, 1);
+		else {
+			n_anchors=0;	// The heaviest placed neighbours, sorted by insertion.
+			for (k=adj_start[v]; k<adj_start[v+1]; k++){
+				if (map[adj_to[k]]<0 || (n_anchors==PLACE_ANCHORS && adj_w[k]<=aw[n_anchors-1]))
+					continue;
+				if (n_anchors<PLACE_ANCHORS)
+					n_anchors++;
+				for (a=n_anchors-1; a>0 && aw[a-1]<adj_w[k]; a--){
+					aw[a]=aw[a-1];
+					anchor[a]=anchor[a-1];
+				}
+				aw[a]=adj_w[k];
+				anchor[a]=map[adj_to[k]];
+			}
+			n_cand=0;
+			for (a=0; a<n_anchors; a++)
+				n_cand+=nearest_free(anchor[a], inv, &cand[n_cand], PLACE_CANDIDATES);
+			for (j=0; j<n_cand; j++){
+				n=cand[j];
+				c=0.0;
+				for (k=adj_start[v]; k<adj_start[v+1]; k++)
+					if (map[adj_to[k]]>=0)
+						c+=adj_w[k]*hops[n*nprocs+map[adj_to[k]]];
+				if (best_n<0 || c<best){
+					best_n=n;
+					best=c;
+				}
+			}
+		}
+		map[v]=best_n;
+		inv[best_n]=v;
+		last=best_n;
+		for (k=adj_start[v]; k<adj_start[v+1]; k++)
+			conn[adj_to[k]]+=adj_w[k];
+	}
+	free(conn);
+	free(total);
+}
+
+/**
+* Gets the change in the cost of moving a task to a node, swapping it with the task in that node, if any.
+*/
+static double move_delta(anneal_t *s, long a, long nb){
+	long na=s->map[a], b=s->inv[nb], k, u;
+	double d=0.0;
+
+	for (k=adj_start[a]; k<adj_start[a+1]; k++)
+		if ((u=adj_to[k])!=b)
+			d+=adj_w[k]*(hops[nb*nprocs+s->map[u]]-hops[na*nprocs+s->map[u]]);
+	if (b>=0)
+		for (k=adj_start[b]; k<adj_start[b+1]; k++)
+			if ((u=adj_to[k])!=a)
+				d+=adj_w[k]*(hops[na*nprocs+s->map[u]]-hops[nb*nprocs+s->map[u]]);
+	return d/2;
+}
+
+/**
+* Runs an annealing chain.
+*
+* The initial temperature is the mean cost increase of some random moves, and it is cooled
+* geometrically down to a thousandth of it in #n_steps moves.
+*
+* @param arg The chain (an anneal_t).
+* @return NULL.
+*/
+static void * anneal(void *arg){
+	anneal_t *s=arg;
+	long step, a, nb, na, b, n=0;
+	double d, temp=0.0, cool;
+
+	for (step=0; step<100; step++){
+		a=rand_r(&s->seed)%n_tasks;
+		nb=rand_r(&s->seed)%nprocs;
+		if ((d=move_delta(s, a, nb))>0){
+			temp+=d;
+			n++;
+		}
+	}
+	if (n==0)
+		return NULL;
+	temp/=n;
+	cool=pow(1e-3, 1.0/n_steps);
+
+	for (step=0; step<n_steps; step++, temp*=cool){
+		a=rand_r(&s->seed)%n_tasks;
+		nb=rand_r(&s->seed)%nprocs;
+		na=s->map[a];
+		if (na==nb)
+			continue;
+		d=move_delta(s, a, nb);
+		if (d>0 && exp(-d/temp)<=(double)rand_r(&s->seed)/RAND_MAX)
+			continue;
+		b=s->inv[nb];
+		s->map[a]=nb;
+		s->inv[nb]=a;
+		s->inv[na]=b;
+		if (b>=0)
+			s->map[b]=na;
+		s->cost+=d;
+	}
+	return NULL;
+}
+
+/**
+* Runs the annealing chains from a mapping, keeping the best one.
+*
+* @param map The initial mapping, updated with the best one found.
+* @param inv The initial inverse mapping, updated with the best one found.
+*/
+static void anneal_mapping(long *map, long *inv){
+	anneal_t s[max(PLACE_THREADS, 1)];
+	long c, best=-1, n_chains=max(PLACE_THREADS, 1);
+	double cost=mapping_cost(map);
+#if (PLACE_THREADS != 0)
+	pthread_t th[PLACE_THREADS];
+#endif
+
+	for (c=0; c<n_chains; c++){
+		s[c].map=alloc(n_tasks*sizeof(long));
+		s[c].inv=alloc(nprocs*sizeof(long));
+		memcpy(s[c].map, map, n_tasks*sizeof(long));
+		memcpy(s[c].inv, inv, nprocs*sizeof(long));
+		s[c].cost=cost;
+		s[c].seed=r_seed+c;
+	}
+#if (PLACE_THREADS != 0)
+	for (c=0; c<n_chains; c++)
+		if (pthread_create(&th[c], NULL, anneal, &s[c]))
+			panic("Cannot create the annealing threads");
+	for (c=0; c<n_chains; c++)
+		pthread_join(th[c], NULL);
+#else
+	anneal(&s[0]);
+#endif
+	for (c=0; c<n_chains; c++){
+		s[c].cost=mapping_cost(s[c].map);	// Without the rounding errors of the deltas.
+		if (s[c].cost<cost){
+			best=c;
+			cost=s[c].cost;
+		}
+	}
+	if (best>=0){
+		memcpy(map, s[best].map, n_tasks*sizeof(long));
+		memcpy(inv, s[best].inv, nprocs*sizeof(long));
+	}
+	for (c=0; c<n_chains; c++){
+		free(s[c].map);
+		free(s[c].inv);
+	}
+}
+
+/**
+* Writes a mapping in #placefile, in the format of the file placement.
+*/
+static void write_mapping(long *map){
+	FILE *fp;
+	long t;
+
+	if((fp = fopen(placefile, "w")) == NULL)
+		panic("Cannot write the placement file");
+	fprintf(fp, "# node task instance. Placement of %s, %.0f hop-bytes\n", trcfile, mapping_cost(map));
+	for (t=0; t<n_tasks; t++)
+		fprintf(fp, "%ld %ld %ld\n", map[t], t%trace_nodes, t/trace_nodes);
+	fclose(fp);
+}
+
+/**
+* Places the tasks of the trace minimizing the hop-bytes & reads the trace.
+*
+* Task t of instance i is vertex t+i*trace_nodes of the graph, which is the node it is placed in by
+* the consecutive placement used when reading the trace the first time.
+*/
+void optimized_placement(){
+	long i, t, *map, *inv;
+
+	n_tasks=trace_nodes*trace_instances;
+	if (n_tasks>nprocs)
+		panic("Too many tasks for the placement optimizer");
+	consecutive_placement();
+	read_trace_file();
+	for (i=0; i<n_tasks; i++)
+		trc_volume(i);
+	clear_trace();
+
+	build_graph();
+	init_links();
+	init_hops();
+	n_steps=(anneal_steps>0)? anneal_steps : 100*n_tasks;
+	map=alloc(n_tasks*sizeof(long));
+	inv=alloc(nprocs*sizeof(long));
+	for (t=0; t<n_tasks; t++)
+		map[t]=t;
+	printf("Placement optimizer:  consecutive %.0f hop-bytes", mapping_cost(map));
+	greedy_mapping(map, inv);
+	printf(", greedy %.0f", mapping_cost(map));
+	anneal_mapping(map, inv);
+	printf(", annealing %.0f\n", mapping_cost(map));
+	write_mapping(map);
+
+	for (i=0; i<nprocs; i++)
+		network[i].source=(inv[i]>=0)? OTHER_SOURCE : INDEPENDENT_SOURCE;
+	for (t=0; t<n_tasks; t++)
+		translation[t%trace_nodes][t/trace_nodes]=map[t];
+	read_trace_file();
+
+	free(map);
+	free(inv);
+	free(hops);
+	free(net_start);
+	free(net_to);
+	free(bfs_queue);
+	free(bfs_mark);
+	free(adj_start);
+	free(adj_to);
+	free(adj_w);
+}
+#endif /* TRACE_SUPPORT */
@@ -71,6 +71,8 @@ char *bheader[] =
 	",  InjAvgDel",
 	", InjStDvDel",
 	",  InjMaxDel",
+	",   DelayP50,   DelayP90,   DelayP99,  DelayP999",
+	",     InjP50,     InjP90,     InjP99,    InjP999",
 };
 
 /**
@@ -152,17 +154,17 @@ void print_partials(void) {
 * @see file.
 */
 void print_results(time_t start_time, time_t end_time) {
-	long i, j, c;
+	long i, j, c, *row;
 	channel e;
 	unsigned long cn_size = 1024;
 	char computer_name[1024];
-	char *topo_s, *vc_s, *routing_s, *pattern_s, *ctype_s, *reqtype_s, *arbtype_s, *inj_s, *placement_s, *cpu_units_s;
+	char *topo_s, *vc_s, *routing_s, *pattern_s, *ctype_s, *reqtype_s, *arbtype_s, *inj_s, *placement_s, *cpu_units_s, *coll_alg_s, *kernel_s, *noise_s;
 	CLOCK_TYPE copyclock;
 
 	char map[256], hst[256];
 
-	double res[13]={0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
-	double res_sq[13]={0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+	double res[13+2*N_PERCENTILES]={0.0};
+	double res_sq[13+2*N_PERCENTILES]={0.0};
 
 	literal_name(pattern_l, &pattern_s, pattern);
 	literal_name(cpu_units_l, &cpu_units_s, cpu_units);
@@ -174,6 +176,9 @@ void print_results(time_t start_time, time_t end_time) {
 	literal_name(ctype_l, &ctype_s, cons_mode);
 	literal_name(injmode_l, &inj_s, inj_mode);
 	literal_name(placement_l, &placement_s, placement);
+	literal_name(coll_alg_l, &coll_alg_s, coll_alg);
+	literal_name(kernel_l, &kernel_s, kernel);
+	literal_name(noise_l, &noise_s, noise);
 
 	samples = reseted ;
 
@@ -216,7 +221,10 @@ void print_results(time_t start_time, time_t end_time) {
 	printf("Cycles per Second:                %f\n\n", 1.0*sim_clock/(end_time-start_time));
 
 	// Random seed
-	printf("Random seed:                      %ld\n\n", r_seed);
+	if (crn)
+		printf("Random seed:                      %ld, common random numbers\n\n", r_seed);
+	else
+		printf("Random seed:                      %ld\n\n", r_seed);
 
 	// Network & router's details
 	printf("Topology, uni(1)/bidir(2):        %s(%ld)", topo_s, nways);
@@ -312,15 +320,42 @@ void print_results(time_t start_time, time_t end_time) {
 	printf("Traffic pattern:                  EXECUTION DRIVEN, packets of %ld phits\n", pkt_len);
 #else
 	if (pattern == TRACE) {// Traffic details.
-		printf("Traffic from trace:               %ld instances of %s, packets of %ld phits (%ld bytes each)\n", trace_instances, trcfile, pkt_len, phit_len);
-		if (placement==SHIFT_PLACE)
+		if (n_jobs>0)
+			printf("Traffic from jobs:                %ld jobs, packets of %ld phits (%ld bytes each)\n", n_jobs, pkt_len, phit_len);
+		else if (kernel!=NO_KERNEL){
+			printf("Traffic from kernel:              %ld instances of %s, packets of %ld phits (%ld bytes each)\n", trace_instances, kernel_s, pkt_len, phit_len);
+			printf("Kernel iterations, msg, cpu:      %ld, %ld bytes, %ld cycles\n", kernel_iters, kernel_bytes, kernel_cpu);
+		}
+		else
+			printf("Traffic from trace:               %ld instances of %s, packets of %ld phits (%ld bytes each)\n", trace_instances, trcfile, pkt_len, phit_len);
+		if (n_jobs>0)
+			print_jobs();
+		else if (placement==SHIFT_PLACE)
 			printf("Placement:                        %s %ld\n", placement_s, shift);
-		else if (placement==FILE_PLACE)
+		else if (placement==FILE_PLACE || placement==OPT_PLACE)
 			printf("Placement:                        %s %s\n", placement_s, placefile);
 		else
 			printf("Placement:                        %s\n", placement_s);
 
 	    printf("Link_bandwidth, CPU_event_units:  %ld Mbps, %s\n", link_bw, cpu_units_s);
+	    printf("CPU speed, op_per_cycle, scale:   %.0f MHz, %.2f, %.3f\n", cpu_speed, op_per_cycle, cpu_scale);
+	    if (n_cpu_ratios>0){
+			printf("CPU/network speed ratios:        ");
+			for (i=0; i<n_cpu_ratios; i++)
+				printf(" %g", cpu_ratios[i]);
+			printf("\n");
+	    }
+	    if (noise!=NO_NOISE || slow_fraction>0.0 || daemon_period>0){
+			printf("CPU noise, slow nodes, daemon:    %s %.3f, %.3f x%.2f, %ld/%ld cycles\n",
+				noise_s, noise_mean, slow_fraction, slow_factor, daemon_len, daemon_period);
+			printf("CPU cycles added by noise:        %"PRINT_CLOCK"\n", noise_cycles);
+	    }
+	    printf("Collectives algorithm:            %s\n", coll_alg_s);
+	    if (eager_threshold>=0){
+			printf("Eager threshold:                  %ld bytes\n", eager_threshold);
+			printf("Rendezvous msgs, avg. handshake:  %ld, %.2f cycles\n", rdv_msgs, (rdv_cts)? (double)rdv_handshake/rdv_cts : 0.0);
+			printf("Cycles blocked waiting for CTS:   %"PRINT_CLOCK"\n", rdv_blocked);
+	    }
 	    printf("Background uniform traffic at:    %1.5f\n", load);
 	}
 	else
@@ -333,9 +368,24 @@ void print_results(time_t start_time, time_t end_time) {
 			printf("Trigger rate, packets triggered:  %1.5f %5ld", trigger_rate, trigger_min);
 			if (trigger_min!=trigger_max)
 			    printf("..%5ld", trigger_max);
-			printf("\nWarm Up Period Prov., Used:       %"PRINT_CLOCK " + %"PRINT_CLOCK", %"PRINT_CLOCK"\n", warm_up_period, max_conv_time, warmed_up);
-			printf("Conv. sampling period, threshold: %"PRINT_CLOCK", %lf\n", conv_period, threshold);
-			printf("Sample count, size, min pkts:     %ld x %"PRINT_CLOCK", %ld\n", samples, batch_time, min_batch_size);
+			if (sat_tolerance > 0.0){
+				printf("\nSaturation load, probes:          %1.5f, %ld\n", sat_load, sat_probes);
+				printf("Search tolerance, probe length:   %lf, %"PRINT_CLOCK"\n", sat_tolerance, sat_probe);
+				printf("Batches at saturation fractions: ");
+				for (i=0; i<N_SAT_FRACTIONS; i++)
+					printf(" %1.2f", sat_fractions[i]);
+				printf("\n");
+			}
+			else {
+				printf("\nWarm Up Period Prov., Used:       %"PRINT_CLOCK " + %"PRINT_CLOCK", %"PRINT_CLOCK"\n", warm_up_period, max_conv_time, warmed_up);
+				if (warm_up_mode == MSER_WARM_UP)
+					printf("MSER-5 period, truncation point:  %"PRINT_CLOCK", %"PRINT_CLOCK"\n", conv_period, truncation);
+				else
+					printf("Conv. sampling period, threshold: %"PRINT_CLOCK", %lf\n", conv_period, threshold);
+				printf("Sample count, size, min pkts:     %ld x %"PRINT_CLOCK", %ld\n", samples, batch_time, min_batch_size);
+				if (ci_precision > 0.0)
+					printf("Precision, max samples:           %lf, %ld\n", ci_precision, ci_max_samples);
+			}
 		}
 
 #endif
@@ -390,12 +440,23 @@ void print_results(time_t start_time, time_t end_time) {
 	}
 #endif /* BIMODAL */
 
+	// Tail latency of all the batches.
+	if (run_delay_hist.count>0){
+		printf("Delay    p50 p90 p99 p99.9:       ");
+		for (i=0; i<N_PERCENTILES; i++)
+			printf(" %10.0f", hist_percentile(&run_delay_hist, percentiles[i]));
+		printf("\nInjDelay p50 p90 p99 p99.9:       ");
+		for (i=0; i<N_PERCENTILES; i++)
+			printf(" %10.0f", hist_percentile(&run_inj_delay_hist, percentiles[i]));
+		printf("\n");
+	}
+
 	printf("\n===============================================================================================================================================================\n");
 
 	// Batch results
 	if (reseted>0) {
         printf("\n  #");
-        for ( i=0; i<13; i++)
+        for ( i=0; i<15; i++)
             if (bheaders & (1 << i))
                 printf("%s",bheader[i]);
         copyclock= (CLOCK_TYPE) 0L;
@@ -470,6 +531,18 @@ void print_results(time_t start_time, time_t end_time) {
 			res[12] += batch[i].max_inj_delay;
 			res_sq[12] += (batch[i].max_inj_delay * (double) batch[i].max_inj_delay);
 		}
+		if (bheaders & 8192)
+			for (j=0; j<N_PERCENTILES; j++){
+				printf(", %10.0f", batch[i].pct_delay[j]);
+				res[13+j] += batch[i].pct_delay[j];
+				res_sq[13+j] += (batch[i].pct_delay[j] * batch[i].pct_delay[j]);
+			}
+		if (bheaders & 16384)
+			for (j=0; j<N_PERCENTILES; j++){
+				printf(", %10.0f", batch[i].pct_inj_delay[j]);
+				res[13+N_PERCENTILES+j] += batch[i].pct_inj_delay[j];
+				res_sq[13+N_PERCENTILES+j] += (batch[i].pct_inj_delay[j] * batch[i].pct_inj_delay[j]);
+			}
 		// copyclock: cycles taken for the sampling period.
 		copyclock += batch[i].clock;
 	}
@@ -505,6 +578,9 @@ void print_results(time_t start_time, time_t end_time) {
 			printf(", %10.2f", (res[11]/samples));
 		if (bheaders & 4096)
 			printf(", %10.2f", (res[12]/samples));
+		for (j=0; j<2*N_PERCENTILES; j++)
+			if (bheaders & (8192 << (j/N_PERCENTILES)))
+				printf(", %10.2f", (res[13+j]/samples));
 		printf("\nSTD");
 
 		if (bheaders & 1)
@@ -533,6 +609,9 @@ void print_results(time_t start_time, time_t end_time) {
 			printf(", %10.2f", sqrt(fabs((res_sq[11] - (res[11]*res[11]) / samples) / (samples-1)) ));
 		if (bheaders & 4096)
 			printf(", %10.2f", sqrt(fabs((res_sq[12] - (res[12]*res[12]) / samples) / (samples-1)) ));
+		for (j=0; j<2*N_PERCENTILES; j++)
+			if (bheaders & (8192 << (j/N_PERCENTILES)))
+				printf(", %10.2f", sqrt(fabs((res_sq[13+j] - (res[13+j]*res[13+j]) / samples) / (samples-1)) ));
 	}
 	printf("\n");
 
@@ -567,22 +646,28 @@ void print_results(time_t start_time, time_t end_time) {
 			printf("WARNING: cannot create network mapping output file");
 		else{
 			if(plevel & 1) {
+				row = alloc(sizeof(long)*nprocs);	// The maps are expanded a row at a time.
 				fprintf(fp, "MAPS OF SOURCES AND DESTINATIONS\n");
 				fprintf(fp, "AT INJECTION\n");
-				for(i=0;i<nprocs;i++)
+				for(i=0;i<nprocs;i++){
+					tmap_row(&sources, i, row);
 					for (j=0;j<nprocs;j++)
 						if (j)
-							fprintf(fp, ", %5ld", sources[i][j]);
+							fprintf(fp, ", %5ld", row[j]);
 						else
-							fprintf(fp, "\n%5ld", sources[i][j]);
+							fprintf(fp, "\n%5ld", row[j]);
+				}
 
 				fprintf(fp, "\n\nAT CONSUMPTION\n");
-				for(i=0;i<nprocs;i++)
+				for(i=0;i<nprocs;i++){
+					tmap_row(&destinations, i, row);
 					for (j=0;j<nprocs;j++)
 						if (j)
-							fprintf(fp, ", %5ld", destinations[i][j]);
+							fprintf(fp, ", %5ld", row[j]);
 						else
-							fprintf(fp, "\n%5ld", destinations[i][j]);
+							fprintf(fp, "\n%5ld", row[j]);
+				}
+				free(row);
 			}
 			if(plevel & 2){
 				fprintf(fp, "\n\nMAPS OF CHANNEL UTILIZATION\n\n");
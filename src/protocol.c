@@ -0,0 +1,412 @@
+/**
+* @file
+* @brief	Eager/rendezvous protocol for trace driven simulation.
+*
+* Messages up to #eager_threshold bytes are sent at once (eager). Larger messages, and
+* synchronous ones, use the rendezvous protocol: the sender injects a request to send (RTS)
+* and waits for the clear to send (CTS) before sending the data. The receiver replies the
+* RTS as soon as the corresponding reception has been posted, either because it is the
+* head of its event queue or because a non-blocking reception was done before.
+* This file is only used when compiling with TRACE_SUPPORT != 0
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "globals.h"
+
+#if (TRACE_SUPPORT != 0)
+
+/**
+* A message in the rendezvous protocol: a non-blocking sent, a posted reception or an arrived RTS.
+*/
+typedef struct rdv_t {
+	event ev;			///< The message. pid is the other end of the communication.
+	CLOCK_TYPE start;	///< Cycle in which the RTS was issued.
+	bool_t cleared;		///< The CTS has been received, so the data can be sent.
+	struct rdv_t *next;	///< Next message in the list.
+} rdv_t;
+
+/**
+* The protocol state of a node.
+*/
+typedef struct rdv_node {
+	event_q ctrl;			///< Control packets (RTS & CTS) waiting to be sent.
+	rdv_t *isends;			///< Non-blocking rendezvous sents, waiting for the CTS or sending data.
+	rdv_t *posted;			///< Non-blocking receptions posted whose RTS has not arrived yet.
+	rdv_t *rts;				///< RTS arrived before their receptions were posted.
+	long ready;				///< Control packets plus cleared non-blocking sents with data to send.
+	bool_t head_waiting;	///< The head (a blocking rendezvous sent) is waiting for the CTS.
+	bool_t head_cleared;	///< The head (a blocking rendezvous sent) has got its CTS.
+	bool_t head_matched;	///< The head (a reception) has already replied an RTS.
+	CLOCK_TYPE head_start;	///< Cycle in which the head (a blocking rendezvous sent) issued its RTS.
+} rdv_node;
+
+static rdv_node *rdv=NULL;	///< The protocol state of each node.
+
+long rdv_outstanding=0;	///< Control packets to send plus unfinished non-blocking sents.
+long rdv_waiting=0;		///< Number of nodes blocked waiting for a CTS.
+long rdv_msgs=0;		///< Number of messages sent with the rendezvous protocol.
+long rdv_cts=0;			///< Number of CTS received.
+CLOCK_TYPE rdv_handshake=0;	///< Accumulated cycles from the RTS to the arrival of the CTS.
+CLOCK_TYPE rdv_blocked=0;	///< Accumulated cycles the nodes have been blocked waiting for a CTS.
+
+/**
+* Initializes the protocol state of all the nodes.
+*/
+void init_protocol(){
+	long i;
+
+	if (eager_threshold<0)
+		return;
+	rdv=alloc(nprocs*sizeof(rdv_node));
+	for (i=0; i<nprocs; i++){
+		init_event(&rdv[i].ctrl);
+		rdv[i].isends=rdv[i].posted=rdv[i].rts=NULL;
+		rdv[i].ready=0;
+		rdv[i].head_waiting=rdv[i].head_cleared=rdv[i].head_matched=B_FALSE;
+		rdv[i].head_start=0;
+	}
+}
+
+/**
+* Selects the event type for a sent, depending on its size.
+*
+* @param bytes The size of the message.
+* @param sync Whether it is a synchronous sent, which always requires a handshake.
+* @param blocking Whether it is a blocking sent.
+* @return SENDING for eager sents, RDV_SENDING or RDV_ISENDING for rendezvous ones.
+*/
+event_t rdv_send_type(long bytes, bool_t sync, bool_t blocking){
+	if (eager_threshold<0 || (!sync && bytes<=eager_threshold))
+		return SENDING;
+	return (blocking)? RDV_SENDING : RDV_ISENDING;
+}
+
+/**
+* Appends a message to a list.
+*/
+static rdv_t * rdv_append(rdv_t **l, event ev){
+	rdv_t *m=alloc(sizeof(rdv_t));
+
+	m->ev=ev;
+	m->start=sim_clock;
+	m->cleared=B_FALSE;
+	m->next=NULL;
+	while (*l!=NULL)
+		l=&(*l)->next;
+	*l=m;
+	return m;
+}
+
+/**
+* Looks for the first message matching a node, tag & length in a list.
+*
+* @param l The list.
+* @param pid The other end of the communication.
+* @param task The tag of the message.
+* @param length The length of the message.
+* @param cleared Whether to look for cleared or not-cleared messages.
+* @return A pointer to the link to the message, or NULL if there is not such a message.
+*/
+static rdv_t ** rdv_find(rdv_t **l, long pid, long task, long length, bool_t cleared){
+	for (; *l!=NULL; l=&(*l)->next)
+		if ((*l)->ev.pid==pid && (*l)->ev.task==task && (*l)->ev.length==length && (*l)->cleared==cleared)
+			return l;
+	return NULL;
+}
+
+/**
+* Unlinks and frees a message from a list.
+*/
+static void rdv_remove(rdv_t **l){
+	rdv_t *m=*l;
+
+	*l=m->next;
+	free(m);
+}
+
+/**
+* Queues a control packet to be sent.
+*/
+static void rdv_control(long i, event_t type, long pid, long task, long length){
+	event ev;
+
+	ev.type=type;
+	ev.pid=pid;
+	ev.task=task;
+	ev.length=length;
+	ev.count=0;
+	ins_event(&rdv[i].ctrl, ev);
+	rdv[i].ready++;
+	rdv_outstanding++;
+#if (ACTIVE_NODES!=0)
+	activate_node(i);
+#endif
+}
+
+/**
+* A message has been posted for reception: it is cleared if its RTS has already arrived.
+*
+* @return TRUE if the RTS was found (and the CTS queued).
+*/
+static bool_t rdv_clear_rts(long i, event e){
+	rdv_t **m=rdv_find(&rdv[i].rts, e.pid, e.task, e.length, B_FALSE);
+
+	if (m==NULL)
+		return B_FALSE;
+	rdv_control(i, CTS, e.pid, e.task, e.length);
+	rdv_remove(m);
+	return B_TRUE;
+}
+
+/**
+* Updates the protocol state of a node whose head event has changed.
+*
+* A new blocking rendezvous sent issues its RTS. A new reception replies an already arrived RTS.
+*
+* @param i The node.
+* @param e The new head event.
+*/
+void rdv_new_head(long i, event e){
+	if (rdv==NULL)
+		return;
+	rdv[i].head_cleared=B_FALSE;
+	rdv[i].head_matched=B_FALSE;
+	switch (e.type){
+		case RDV_SENDING:
+			rdv_control(i, RTS, e.pid, e.task, e.length);
+			rdv[i].head_waiting=B_TRUE;
+			rdv[i].head_start=sim_clock;
+			rdv_waiting++;
+			rdv_msgs++;
+			break;
+		case RECEPTION:
+			rdv[i].head_matched=rdv_clear_rts(i, e);
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+* Performs a head event which does not need to wait: a non-blocking reception is posted and
+* a non-blocking rendezvous sent issues its RTS.
+*
+* @param i The node.
+* @param e The head event.
+*/
+void rdv_nonblocking(long i, event e){
+	rdv_t *m;
+
+	if (e.type==IRECEPTION){
+		if (!rdv_clear_rts(i, e))
+			rdv_append(&rdv[i].posted, e);
+	}
+	else if (e.type==RDV_ISENDING){
+		m=rdv_append(&rdv[i].isends, e);
+		m->ev.count=0;
+		rdv_control(i, RTS, e.pid, e.task, e.length);
+		rdv_outstanding++;
+		rdv_msgs++;
+	}
+}
+
+/**
+* Checks whether the RTS of a message has arrived and is waiting for its reception to be posted.
+*
+* @param i The node.
+* @param e The reception.
+*/
+bool_t rdv_rts_arrived(long i, event e){
+	return (rdv!=NULL && rdv_find(&rdv[i].rts, e.pid, e.task, e.length, B_FALSE)!=NULL);
+}
+
+/**
+* Checks whether the head of a node (a blocking rendezvous sent) can send its data.
+*/
+bool_t rdv_cleared(long i){
+	return (rdv!=NULL && rdv[i].head_cleared);
+}
+
+/**
+* Checks whether a node has protocol work to do: control packets, data of cleared sents or
+* non-blocking events in the head.
+*/
+bool_t rdv_has_work(long i){
+	if (rdv==NULL || i>=nprocs)
+		return B_FALSE;
+	return (rdv[i].ready>0 || rdv[i].head_cleared ||
+			network[i].head==IRECEPTION || network[i].head==RDV_ISENDING);
+}
+
+/**
+* Gets the next packet due to the protocol in a node: control packets first, then the data of the
+* cleared non-blocking sents.
+*
+* @param i The node.
+* @param pkt The packet to fill (kind, task & length).
+* @param d The destination of the packet.
+* @return TRUE if there is a packet to send.
+*/
+bool_t rdv_packet(long i, packet_t *pkt, long *d){
+	event e;
+	rdv_t **m;
+
+	if (rdv==NULL || rdv[i].ready==0)
+		return B_FALSE;
+	if (!event_empty(&rdv[i].ctrl)){
+		e=head_event(&rdv[i].ctrl);
+		rem_head_event(&rdv[i].ctrl);
+		rdv[i].ready--;
+		rdv_outstanding--;
+		pkt->kind=e.type;
+	}
+	else {
+		for (m=&rdv[i].isends; !(*m)->cleared; m=&(*m)->next)
+			;
+		e=(*m)->ev;
+		if (++(*m)->ev.count==e.length){
+			crit_sent(i, e);
+			rdv_remove(m);
+			rdv[i].ready--;
+			rdv_outstanding--;
+		}
+		pkt->kind=SENDING;
+	}
+	pkt->task=e.task;
+	pkt->length=e.length;
+	*d=e.pid;
+	return B_TRUE;
+}
+
+/**
+* A control packet of the rendezvous protocol has arrived.
+*
+* An RTS is replied if its reception has been posted, or kept until it is. A CTS clears the
+* blocking sent in the head, or the first non-blocking sent waiting for it.
+*
+* @param i The node in which the packet has arrived.
+* @param pkt The packet.
+*/
+void rdv_arrival(long i, packet_t *pkt){
+	event e;
+	rdv_t **m;
+
+	e.type=RECEPTION;
+	e.pid=pkt->from;
+	e.task=pkt->task;
+	e.length=pkt->length;
+	e.count=0;
+
+	if (pkt->kind==RTS){
+		if (network[i].head==RECEPTION && !rdv[i].head_matched){
+			event h=head_event(&network[i].events);
+			if (h.pid==e.pid && h.task==e.task && h.length==e.length){
+				rdv_control(i, CTS, e.pid, e.task, e.length);
+				rdv[i].head_matched=B_TRUE;
+				// The head may be the wait of a non-blocking reception posted before.
+				if ((m=rdv_find(&rdv[i].posted, e.pid, e.task, e.length, B_FALSE))!=NULL)
+					rdv_remove(m);
+				return;
+			}
+		}
+		if ((m=rdv_find(&rdv[i].posted, e.pid, e.task, e.length, B_FALSE))!=NULL){
+			rdv_control(i, CTS, e.pid, e.task, e.length);
+			rdv_remove(m);
+		}
+		else
+			rdv_append(&rdv[i].rts, e);
+		return;
+	}
+
+	// CTS
+	if (network[i].head==RDV_SENDING && rdv[i].head_waiting){
+		event h=head_event(&network[i].events);
+		if (h.pid==e.pid && h.task==e.task && h.length==e.length){
+			rdv[i].head_waiting=B_FALSE;
+			rdv[i].head_cleared=B_TRUE;
+			rdv_waiting--;
+			rdv_cts++;
+			rdv_handshake+=sim_clock-rdv[i].head_start;
+			rdv_blocked+=sim_clock-rdv[i].head_start;
+			return;
+		}
+	}
+	if ((m=rdv_find(&rdv[i].isends, e.pid, e.task, e.length, B_FALSE))==NULL)
+		panic("Unexpected clear to send");
+	(*m)->cleared=B_TRUE;
+	rdv[i].ready++;
+	rdv_cts++;
+	rdv_handshake+=sim_clock-(*m)->start;
+}
+
+/**
+* Saves or restores a list of messages in a checkpoint. The messages are replaced when restoring.
+*/
+static void rdv_list_checkpoint(rdv_t **l){
+	rdv_t *m;
+	long n=0, k;
+
+	if (ckpt_saving()){
+		for (m=*l; m!=NULL; m=m->next)
+			n++;
+		CKPT(n);
+		for (m=*l; m!=NULL; m=m->next){
+			CKPT(m->ev);
+			CKPT(m->start);
+			CKPT(m->cleared);
+		}
+		return;
+	}
+	while (*l!=NULL)
+		rdv_remove(l);
+	CKPT(n);
+	for (k=0; k<n; k++, l=&(*l)->next){
+		*l=m=alloc(sizeof(rdv_t));
+		CKPT(m->ev);
+		CKPT(m->start);
+		CKPT(m->cleared);
+		m->next=NULL;
+	}
+}
+
+/**
+* Saves or restores the protocol state of all the nodes in a checkpoint.
+*/
+void rdv_checkpoint(){
+	long i;
+
+	if (rdv==NULL)
+		return;
+	CKPT(rdv_outstanding);
+	CKPT(rdv_waiting);
+	CKPT(rdv_msgs);
+	CKPT(rdv_cts);
+	CKPT(rdv_handshake);
+	CKPT(rdv_blocked);
+	for (i=0; i<nprocs; i++){
+		event_checkpoint(&rdv[i].ctrl);
+		rdv_list_checkpoint(&rdv[i].isends);
+		rdv_list_checkpoint(&rdv[i].posted);
+		rdv_list_checkpoint(&rdv[i].rts);
+		CKPT(rdv[i].ready);
+		CKPT(rdv[i].head_waiting);
+		CKPT(rdv[i].head_cleared);
+		CKPT(rdv[i].head_matched);
+		CKPT(rdv[i].head_start);
+	}
+}
+#endif /* TRACE_SUPPORT */
@@ -74,7 +74,7 @@ void router_init(void) {
 
 		network[i].injecting_port = NULL_PORT;
 		network[i].next_port = 0;
-#if (PCOUNT!=0)
+#if (PCOUNT!=0 || ACTIVE_NODES!=0)
 		network[i].pcount = 0;
 #endif
 		// Congestion with timeouts.
@@ -84,6 +84,12 @@ void router_init(void) {
 
 		network[i].triggered=0;
 
+#if (TRACE_SUPPORT != 0)
+		network[i].head=NO_EVENT;
+		network[i].cpu_end=CLOCK_MAX;
+		network[i].job=-1;
+#endif
+
 #if (TRACE_SUPPORT == 1)
 		if (i<nprocs){
 			init_event(&network[i].events);
@@ -124,7 +124,7 @@ typedef struct router {
 	long pending_packet;		///< Number of packets awaiting
 	long triggered;				///< Number of packets triggered by incoming packets - Reactive traffic.
 
-#if (PCOUNT!=0)
+#if (PCOUNT!=0 || ACTIVE_NODES!=0)
 	/**
 	* Total phits within the router.
 	* If this value is 0 the router ports wont be checked to for requesting, arbitrating or moving.
@@ -139,16 +139,24 @@ typedef struct router {
 	bool_t congested;				///< Has this router detected congestion?
 
 	source_t source;           ///< The source type. May be independent, no source or other.
+	unsigned int traffic_seed;	///< State of the random stream of the traffic generated by this node, used with common random numbers.
+	unsigned int trigger_seed;	///< State of the random stream of the packets triggered in this node, used with common random numbers.
 	
 	// Ports and injectors
 #if (TRACE_SUPPORT == 1)
 	event_q events;		///< A Queue with events to occur
 	event_l occurs;	///< Lists with occurred events (one for each messsage source)
+	event_t head;		///< Type of the event in the head of #events, as last seen by the trace engine.
+	CLOCK_TYPE cpu_end;	///< Cycle in which the current computation event finishes.
+	long job;			///< Job running in this node, -1 if none.
 #endif /* TRACE */
 
 #if (TRACE_SUPPORT > 1)
 	event_q events;		///< A Queue with events to occur
 	event_l *occurs;	///< Lists with occurred events (one for each messsage source)
+	event_t head;		///< Type of the event in the head of #events, as last seen by the trace engine.
+	CLOCK_TYPE cpu_end;	///< Cycle in which the current computation event finishes.
+	long job;			///< Job running in this node, -1 if none.
 #endif /* TRACE */
 } router;
 #endif /* _router */
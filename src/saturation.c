@@ -0,0 +1,151 @@
+/**
+* @file
+* @brief	Running mode looking for the saturation load of the synthetic traffic.
+*
+* The provided load is searched by bisection. Each probe runs a short warm-up, starting from the state
+* left by the previous probe, and then a measurement in two halves. The load is considered saturated if
+* the accepted load is below the provided one, the injection queues grow or the latency grows between
+* both halves, beyond the convergency threshold. Once the saturation load is found, a batch is taken
+* at some fractions of it.
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "globals.h"
+
+/**
+* Runs the simulation for some cycles.
+*
+* @param n The number of cycles.
+*/
+static void run_cycles(CLOCK_TYPE n){
+	CLOCK_TYPE end=sim_clock+n;
+
+	while (sim_clock < end && !interrupted && !aborted){
+		data_movement(B_TRUE);
+		sim_clock++;
+		if ((pheaders > 0) && (sim_clock % pinterval == 0))
+			print_partials();
+
+		if (sim_clock % update_period == 0){
+			global_q_u = global_q_u_current;
+			global_q_u_current = injected_count - rcvd_count - transit_dropped_count;
+		}
+	}
+}
+
+/**
+* Phits waiting in the injection queues of all the nodes.
+*/
+static double inj_backlog(void){
+	double b=0.0;
+	long i, p;
+
+	for (i=0; i<nprocs; i++)
+		for (p=0; p<ninj; p++)
+			b+=inj_queue_len(&network[i].qi[p]);
+	return b;
+}
+
+/**
+* Average latency since the last reset.
+*/
+static double latency_now(void){
+	double rcvd=rcvd_count - last_rcvd_count;
+
+	return (rcvd>0)? acum_delay/rcvd : 0.0;
+}
+
+/**
+* Runs a probe of the saturation search.
+*
+* @param l The provided load.
+* @return TRUE if the network is saturated at this load or FALSE in other case.
+*/
+static bool_t probe(double l){
+	double b0, lat1, lat2, acc, growth;
+	bool_t sat;
+
+	set_load(l);
+	run_cycles(sat_probe);
+	reseted=-1;
+	reset_stats();
+	b0=inj_backlog();
+	run_cycles(sat_probe/2);
+	lat1=latency_now();
+	acc=rcvd_phit_count;
+	reset_stats();
+	run_cycles(sat_probe-sat_probe/2);
+	lat2=latency_now();
+	acc=(acc+rcvd_phit_count)/(1.0*nprocs*sat_probe);
+	growth=(inj_backlog()-b0)/(1.0*nprocs*sat_probe);
+
+	// The latency of short halves is noisy, so it must grow twice the threshold.
+	sat=(bool_t)(acc < l*(1.0-threshold) || growth > l*threshold || lat2 > lat1*(1.0+2.0*threshold));
+	printf("Probe at load %1.5f: accepted %1.5f, queue growth %1.5f, latency %8.2f -> %8.2f: %s\n",
+			l, acc, growth, lat1, lat2, (sat)? "saturated" : "stable");
+	return sat;
+}
+
+/**
+* Run the simulation looking for the saturation load.
+*
+* The upper bound is doubled from 1 phit/cycle/node until a saturated probe (or the number of injectors),
+* then bisection until the interval is within #sat_tolerance,
+* and then a batch of #sat_probe cycles at each of the #sat_fractions of the saturation load.
+*
+* @see probe()
+*/
+void run_network_saturation(void){
+	double lo=0.0, hi=1.0, mid;
+	long k;
+
+	sat_probes=0;
+	while (!interrupted && !aborted){	// Upper bound: the load cannot go beyond the injectors of a node.
+		sat_probes++;
+		if (probe(hi))
+			break;
+		lo=hi;
+		if (hi >= ninj)
+			break;
+		hi*=2.0;
+	}
+	while (hi-lo > sat_tolerance && !interrupted && !aborted){
+		mid=(lo+hi)/2.0;
+		if (probe(mid))
+			hi=mid;
+		else
+			lo=mid;
+		sat_probes++;
+	}
+	sat_load=lo;
+	printf("\n ---------------------------------------------\n");
+	printf("          Saturation load: %1.5f            \n", sat_load);
+	printf(" ---------------------------------------------\n\n");
+
+	warmed_up = sim_clock;
+	for (k=0; k<N_SAT_FRACTIONS && !interrupted && !aborted; k++){
+		set_load(sat_fractions[k]*sat_load);
+		run_cycles(sat_probe);
+		reseted=k-1;	// The stats of the warm-up are discarded, & the batch is saved in its place.
+		reset_stats();
+		run_cycles(sat_probe);
+		save_batch_results();
+		print_batch_results(&batch[reseted]);
+		reset_stats();
+	}
+	set_load(sat_load);
+}
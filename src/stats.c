@@ -46,6 +46,104 @@ void stats(long i) {
 	}
 }
 
+/**
+* Empties a latency histogram.
+*
+* @param h The histogram.
+*/
+void hist_reset(hist_t *h){
+	long b;
+
+	h->count=0.0;
+	h->max=0;
+	for (b=0; b<HIST_BUCKETS; b++)
+		h->bucket[b]=0.0;
+}
+
+/**
+* Gets the position of the most significant bit of a positive value.
+*/
+static long msb(unsigned long long v){
+#ifdef __GNUC__
+	return 63-__builtin_clzll(v);
+#else
+	long b=0;
+
+	while (v>>=1)
+		b++;
+	return b;
+#endif
+}
+
+/**
+* Records a value in a latency histogram.
+*
+* @param h The histogram.
+* @param v The value.
+*/
+void hist_record(hist_t *h, CLOCK_TYPE v){
+	long e;
+
+	if (v<0)
+		v=0;
+	if (v<HIST_SUB)
+		h->bucket[v]++;
+	else {
+		e=msb((unsigned long long)v)-HIST_SUB_BITS;	// The bits dropped.
+		h->bucket[(e+1)*HIST_SUB+(v>>e)-HIST_SUB]++;
+	}
+	h->count++;
+	if (v>h->max)
+		h->max=v;
+}
+
+/**
+* Adds the values of a latency histogram to another one.
+*
+* @param to The histogram receiving the values.
+* @param from The histogram whose values are added.
+*/
+void hist_merge(hist_t *to, hist_t *from){
+	long b;
+
+	for (b=0; b<HIST_BUCKETS; b++)
+		to->bucket[b]+=from->bucket[b];
+	to->count+=from->count;
+	if (from->max>to->max)
+		to->max=from->max;
+}
+
+/**
+* Gets a percentile of a latency histogram.
+*
+* @param h The histogram.
+* @param p The percentile, in [0, 1].
+* @return The highest value of the bucket in which the percentile falls (the maximum recorded in the last one).
+*/
+double hist_percentile(hist_t *h, double p){
+	double rank, acc=0.0;
+	long b, k;
+	CLOCK_TYPE top;
+
+	if (h->count==0)
+		return 0.0;
+	rank=ceil(p*h->count);
+	if (rank<1)
+		rank=1;
+	for (b=0; b<HIST_BUCKETS; b++){
+		acc+=h->bucket[b];
+		if (acc>=rank)
+			break;
+	}
+	if (b<HIST_SUB)
+		top=b;
+	else {
+		k=b/HIST_SUB;
+		top=((CLOCK_TYPE)(HIST_SUB+b%HIST_SUB+1)<<(k-1))-1;
+	}
+	return (double)min(top, h->max);
+}
+
 /**
 * Resets the stats of the simulation.
 *
@@ -75,6 +173,8 @@ void reset_stats(void) {
 	acum_sq_delay = 0.0;
 	acum_sq_inj_delay = 0.0;
 	acum_hops = 0.0;
+	hist_reset(&delay_hist);
+	hist_reset(&inj_delay_hist);
 
 	if (reseted < 0){
 		for (e=0; e<n_ports; e++){
@@ -113,12 +213,10 @@ void reset_stats(void) {
 		dest_ports[e]=0;
 	}
 
-	if (plevel & 1)
-		for (i=0; i<nprocs; i++)
-			for (j=0; j<nprocs; j++){
-				destinations[i][j]=0;
-				sources[i][j]=0;
-			}
+	if (plevel & 1){
+		tmap_reset(&destinations);
+		tmap_reset(&sources);
+	}
 
 	for (i=0; i<NUMNODES; i++){
 		for (e=0; e<p_inj_first; e++)
@@ -0,0 +1,345 @@
+/**
+* @file
+* @brief	Sweep of simulations over a grid of parameters.
+*
+* The grid file has a line for each swept option, with its values separated by commas:
+*
+* load=0.1,0.2,0.3
+* tpattern=uniform,complement
+*
+* A simulation is run for each combination of values (the last option changes first), adding
+* the options to the ones of the command line. The simulations run concurrently in forked
+* workers, each one writing its full report to #sweep_file.<point>.out, its output files with
+* the prefix #file.<point> and a row of results to #sweep_file.csv. The points already in the
+* csv file are not run again, so an interrupted sweep is resumed by launching it again. When
+* all the points are done the results are also written to #sweep_file.json.
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "globals.h"
+
+extern time_t start_time;
+
+#define MAX_SWEEP_PARAMS 16	///< Maximum number of swept options.
+#define SWEEP_LINE 1024		///< Maximum length of a line in the grid & csv files.
+
+static long n_params=0;					///< Number of swept options.
+static char *names[MAX_SWEEP_PARAMS];	///< Names of the swept options.
+static char **values[MAX_SWEEP_PARAMS];	///< Values of each swept option.
+static long n_values[MAX_SWEEP_PARAMS];	///< Number of values of each swept option.
+static long n_points=1;					///< Number of points in the grid.
+
+/**
+* Reads the grid of parameters.
+*/
+static void read_grid(void){
+	FILE *f;
+	char buffer[SWEEP_LINE], *name, *v;
+	long n;
+
+	if ((f=fopen(sweep_file, "r"))==NULL)
+		panic("Cannot read the sweep file");
+	while (fgets(buffer, SWEEP_LINE, f)!=NULL){
+		buffer[strcspn(buffer, "\r\n")]='\0';
+		if (buffer[0]=='\0' || buffer[0]=='#')
+			continue;
+		if (n_params==MAX_SWEEP_PARAMS)
+			panic("Too many options in the sweep file");
+		if ((name=strtok(buffer, "="))==NULL || (v=strtok(NULL, "="))==NULL)
+			panic("Wrong line in the sweep file");
+		names[n_params]=strdup(name);
+		values[n_params]=alloc((strlen(v)+1)*sizeof(char*));
+		for (n=0, v=strtok(v, ","); v!=NULL; v=strtok(NULL, ","))
+			values[n_params][n++]=strdup(v);
+		n_values[n_params]=n;
+		n_points*=n;
+		n_params++;
+	}
+	fclose(f);
+}
+
+/**
+* Gets the value of a swept option in a point of the grid.
+*
+* @param k The point.
+* @param p The swept option.
+* @return The index of the value.
+*/
+static long value_index(long k, long p){
+	long q;
+
+	for (q=n_params-1; q>p; q--)
+		k/=n_values[q];
+	return k%n_values[p];
+}
+
+/**
+* Looks for the points already done, writing the header of the csv file if it is new.
+*
+* @param name The name of the csv file.
+* @return An array with the points done.
+*/
+static bool_t * done_points(char *name){
+	FILE *f;
+	char buffer[SWEEP_LINE];
+	bool_t *done=alloc(n_points*sizeof(bool_t));
+	long k, p;
+
+	for (k=0; k<n_points; k++)
+		done[k]=B_FALSE;
+	if ((f=fopen(name, "r"))!=NULL){
+		if (fgets(buffer, SWEEP_LINE, f)!=NULL)	// The header.
+			while (fgets(buffer, SWEEP_LINE, f)!=NULL)
+				if ((k=atol(buffer))>=0 && k<n_points)
+					done[k]=B_TRUE;
+		fclose(f);
+		return done;
+	}
+	if ((f=fopen(name, "w"))==NULL)
+		panic("Cannot write the sweep csv file");
+	fprintf(f, "point");
+	for (p=0; p<n_params; p++)
+		fprintf(f, ",%s", names[p]);
+	fprintf(f, ",cycles,batches,inj_load,acc_load,avg_delay,p50_delay,p99_delay,max_delay,avg_inj_delay,status\n");
+	fclose(f);
+	return done;
+}
+
+/**
+* Appends the results of the simulation of a point to the csv file.
+*
+* The row is written with a single write, so the rows of concurrent workers do not mix.
+*
+* @param name The name of the csv file.
+* @param k The point.
+*/
+static void record_point(char *name, long k){
+	char row[SWEEP_LINE];
+	double inj=0.0, acc=0.0, delay=0.0, inj_delay=0.0;
+	long i, p, len, max=0, fd;
+
+	for (i=0; i<samples; i++){
+		inj+=batch[i].inj_load;
+		acc+=batch[i].acc_load;
+		delay+=batch[i].avg_delay;
+		inj_delay+=batch[i].avg_inj_delay;
+		if (batch[i].max_delay>max)
+			max=batch[i].max_delay;
+	}
+	if (samples>0){
+		inj/=samples;
+		acc/=samples;
+		delay/=samples;
+		inj_delay/=samples;
+	}
+	len=sprintf(row, "%ld", k);
+	for (p=0; p<n_params; p++)
+		len+=snprintf(row+len, SWEEP_LINE/2, ",%s", values[p][value_index(k, p)]);
+	len+=sprintf(row+len, ",%"PRINT_CLOCK",%ld,%f,%f,%f,%.0f,%.0f,%ld,%f,%s\n",
+			sim_clock, samples, inj, acc, delay,
+			hist_percentile(&run_delay_hist, 0.5), hist_percentile(&run_delay_hist, 0.99),
+			max, inj_delay, (aborted)? "aborted" : "ok");
+
+	if ((fd=open(name, O_WRONLY|O_APPEND))<0 || write(fd, row, len)!=len)
+		panic("Cannot write the sweep csv file");
+	close(fd);
+}
+
+/**
+* Simulates a point of the grid. Runs in a forked worker, and does not return.
+*
+* @param k The point.
+* @param argn The number of arguments in the command line.
+* @param args The arguments in the command line.
+* @param csv The name of the csv file.
+*/
+static void run_point(long k, long argn, char **args, char *csv){
+	char **a=alloc((argn+n_params)*sizeof(char*));
+	char name[160];
+	long i, p;
+
+	for (i=0; i<argn; i++)
+		a[i]=args[i];
+	for (p=0; p<n_params; p++){
+		a[argn+p]=alloc(strlen(names[p])+strlen(values[p][value_index(k, p)])+2);
+		sprintf(a[argn+p], "%s=%s", names[p], values[p][value_index(k, p)]);
+	}
+	sprintf(name, "%s.%ld.out", sweep_file, k);
+	if (freopen(name, "w", stdout)==NULL)
+		panic("Cannot write the output of a point of the sweep");
+
+	time(&start_time);
+	get_conf(argn+n_params, a);
+
+	// Each point writes its own output files, as the forked variants do.
+	sprintf(name, "%s.%ld", file, k);
+	strcpy(file, name);
+	fclose(fp);
+	sprintf(name, "%s.mon", file);
+	if((fp = fopen(name, "w")) == NULL)
+		panic("cannot create monitorized output file");
+	if (ckpt_file[0] != '\0'){
+		sprintf(name, "%s.%ld", ckpt_file, k);
+		strcpy(ckpt_file, name);
+	}
+	sweep_file[0]='\0';
+	simulate();
+	if (!interrupted)
+		record_point(csv, k);
+	fflush(stdout);
+	exit(0);
+}
+
+/**
+* Writes the results in the csv file as a json array, ordered by point.
+*
+* @param csv The name of the csv file.
+*/
+static void write_json(char *csv){
+	FILE *f, *j;
+	char name[140], head[SWEEP_LINE], buffer[SWEEP_LINE];
+	char *cols[MAX_SWEEP_PARAMS+16], *c, **rows=alloc(n_points*sizeof(char*));
+	long n_cols=0, k, i, n;
+
+	if ((f=fopen(csv, "r"))==NULL || fgets(head, SWEEP_LINE, f)==NULL)
+		panic("Cannot read the sweep csv file");
+	head[strcspn(head, "\r\n")]='\0';
+	for (c=strtok(head, ","); c!=NULL && n_cols<MAX_SWEEP_PARAMS+16; c=strtok(NULL, ","))
+		cols[n_cols++]=c;
+	for (k=0; k<n_points; k++)
+		rows[k]=NULL;
+	while (fgets(buffer, SWEEP_LINE, f)!=NULL)
+		if ((k=atol(buffer))>=0 && k<n_points && rows[k]==NULL)
+			rows[k]=strdup(buffer);
+	fclose(f);
+
+	sprintf(name, "%s.json", sweep_file);
+	if ((j=fopen(name, "w"))==NULL)
+		panic("Cannot write the sweep json file");
+	fprintf(j, "[");
+	for (n=0, k=0; k<n_points; k++){
+		if (rows[k]==NULL)
+			continue;
+		rows[k][strcspn(rows[k], "\r\n")]='\0';
+		fprintf(j, (n++)? ",\n {" : "\n {");
+		for (i=0, c=strtok(rows[k], ","); c!=NULL && i<n_cols; i++, c=strtok(NULL, ",")){
+			if (i==0 || (i>n_params && i<n_cols-1))	// Point & figures are numbers, options & status strings.
+				fprintf(j, "%s\"%s\": %s", (i)? ", " : "", cols[i], c);
+			else
+				fprintf(j, ", \"%s\": \"%s\"", cols[i], c);
+		}
+		fprintf(j, "}");
+		free(rows[k]);
+	}
+	fprintf(j, "\n]\n");
+	fclose(j);
+	free(rows);
+}
+
+#if (TRACE_SUPPORT != 0)
+/**
+* Can the trace be read once for all the points?
+*
+* Only a single trace file, when no swept option changes the trace read.
+*
+* @return TRUE if the trace can be read before forking the workers.
+*/
+static bool_t shared_trace(void){
+	long p;
+
+	if (pattern!=TRACE || kernel!=NO_KERNEL || jobfile[0]!='\0' || joblog[0]!='\0')
+		return B_FALSE;
+	for (p=0; p<n_params; p++)
+		if (trace_option(names[p]))
+			return B_FALSE;
+	return B_TRUE;
+}
+#endif /* TRACE_SUPPORT */
+
+/**
+* Runs the sweep.
+*
+* Forks a worker for each point not done yet, keeping at most #sweep_workers running.
+* When interrupted, no more workers are started, & the running ones are waited.
+* If the points only differ in options which do not change the trace read, it is read
+* before forking the workers (share_trace()), which get a copy of it.
+*
+* @param argn The number of arguments in the command line.
+* @param args The arguments in the command line.
+*/
+void run_sweep(long argn, char **args){
+	char csv[140];
+	bool_t *done;
+	long k, n_done=0, running=0, workers=sweep_workers;
+	pid_t pid;
+
+	read_grid();
+	sprintf(csv, "%s.csv", sweep_file);
+	done=done_points(csv);
+	for (k=0; k<n_points; k++)
+		n_done+=done[k];
+	if (workers<=0)
+		workers=sysconf(_SC_NPROCESSORS_ONLN);
+	if (workers<=0)
+		workers=1;
+	printf("Sweep of %ld points, %ld already done, with %ld workers\n", n_points, n_done, workers);
+#if (TRACE_SUPPORT != 0)
+	if (n_done<n_points && shared_trace()){
+		printf("Reading the trace once for all the points\n");
+		share_trace();
+	}
+#endif
+
+	for (k=0; k<n_points && !interrupted; k++){
+		if (done[k])
+			continue;
+		while (running==workers && !interrupted)
+			if (wait(NULL)>0)
+				running--;
+		if (interrupted)
+			break;
+		fflush(stdout);
+		if ((pid=fork())<0)
+			panic("Cannot fork a worker of the sweep");
+		if (pid==0)
+			run_point(k, argn, args, csv);
+		running++;
+	}
+	while (running>0)
+		if (wait(NULL)>0)
+			running--;
+		else if (errno!=EINTR)
+			break;
+
+	free(done);
+	done=done_points(csv);
+	for (n_done=0, k=0; k<n_points; k++)
+		n_done+=done[k];
+	printf("Sweep: %ld of %ld points done, results in %s\n", n_done, n_points, csv);
+	if (n_done==n_points)
+		write_json(csv);
+	free(done);
+}
+#endif /* WIN32 */
@@ -0,0 +1,295 @@
+/**
+* @file
+* @brief	Maps of sources & destinations.
+*
+* The maps count the packets between each pair of nodes (plevel & 1). A dense matrix takes
+* nprocs^2 counters, which is not affordable in large networks, so each source keeps a hash
+* table with the destinations it has sent packets to. When the traffic is so spread that even
+* that is too big, a count-min sketch of a fixed size approximates the map (option map_sketch).
+* The maps are expanded row by row only when they are printed.
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "globals.h"
+
+#define TMAP_MIN_SIZE 8	///< Slots of the hash table of a source when it sends its first packet.
+
+/**
+* Scrambles the bits of a key (splitmix64 finalizer).
+*/
+static unsigned long long mix(unsigned long long x){
+	x^=x>>30;
+	x*=0xBF58476D1CE4E5B9ULL;
+	x^=x>>27;
+	x*=0x94D049BB133111EBULL;
+	x^=x>>31;
+	return x;
+}
+
+/**
+* Gets the counter of a pair in a row of the sketch.
+*
+* @param m The map.
+* @param d The row of the sketch.
+* @param from The source.
+* @param to The destination.
+* @return The position of the counter in the sketch.
+*/
+static long sketch_pos(tmap_t *m, long d, long from, long to){
+	unsigned long long key=(unsigned long long)from*nprocs+to;
+
+	return d*m->width + (long)(mix(key+(d+1)*0x9E3779B97F4A7C15ULL) % m->width);
+}
+
+/**
+* Finds the slot of a destination in the hash table of a source.
+*
+* @param r The hash table, which must have some slot.
+* @param dst The destination.
+* @return The slot of the destination or the empty one where it should go.
+*/
+static tmap_slot_t *row_find(tmap_row_t *r, long dst){
+	long s;
+
+	for (s=(long)(mix(dst) & (r->size-1)); r->slot[s].dst!=-1 && r->slot[s].dst!=dst; s=(s+1) & (r->size-1))
+		;
+	return &r->slot[s];
+}
+
+/**
+* Doubles the size of the hash table of a source.
+*
+* @param r The hash table.
+*/
+static void row_grow(tmap_row_t *r){
+	tmap_slot_t *old=r->slot;
+	long s, old_size=r->size;
+
+	r->size=(old_size)? 2*old_size : TMAP_MIN_SIZE;
+	r->slot=alloc(r->size*sizeof(tmap_slot_t));
+	for (s=0; s<r->size; s++){
+		r->slot[s].dst=-1;
+		r->slot[s].count=0;
+	}
+	for (s=0; s<old_size; s++)
+		if (old[s].dst!=-1)
+			*row_find(r, old[s].dst)=old[s];
+	free(old);
+}
+
+/**
+* Adds some packets to a destination in the hash table of a source.
+*
+* The table is kept at most half full, so the probe sequences are short.
+*
+* @param r The hash table.
+* @param dst The destination.
+* @param count The packets to add.
+*/
+static void row_add(tmap_row_t *r, long dst, long count){
+	tmap_slot_t *sl;
+
+	if (r->size==0)
+		row_grow(r);
+	sl=row_find(r, dst);
+	if (sl->dst==-1){
+		if (2*(r->used+1) > r->size){
+			row_grow(r);
+			sl=row_find(r, dst);
+		}
+		sl->dst=dst;
+		r->used++;
+	}
+	sl->count+=count;
+}
+
+/**
+* Prepares an empty map.
+*
+* @param m The map.
+* @param width The counters in each row of the sketch, 0 for an exact map.
+*/
+void tmap_init(tmap_t *m, long width){
+	long i;
+
+	m->width=width;
+	m->row=NULL;
+	m->sketch=NULL;
+	if (width){
+		m->sketch=alloc(TMAP_DEPTH*width*sizeof(long));
+		for (i=0; i<TMAP_DEPTH*width; i++)
+			m->sketch[i]=0;
+	}
+	else {
+		m->row=alloc(nprocs*sizeof(tmap_row_t));
+		for (i=0; i<nprocs; i++){
+			m->row[i].size=0;
+			m->row[i].used=0;
+			m->row[i].slot=NULL;
+		}
+	}
+}
+
+/**
+* Empties a map, keeping the memory of the hash tables.
+*
+* @param m The map.
+*/
+void tmap_reset(tmap_t *m){
+	long i, s;
+
+	if (m->width){
+		for (i=0; i<TMAP_DEPTH*m->width; i++)
+			m->sketch[i]=0;
+		return;
+	}
+	for (i=0; i<nprocs; i++){
+		for (s=0; s<m->row[i].size; s++){
+			m->row[i].slot[s].dst=-1;
+			m->row[i].slot[s].count=0;
+		}
+		m->row[i].used=0;
+	}
+}
+
+/**
+* Counts a packet in a map.
+*
+* In the sketch only the lowest counters of the pair are increased (conservative update), which
+* keeps the overestimation lower than increasing them all.
+*
+* @param m The map.
+* @param from The source of the packet.
+* @param to The destination of the packet.
+*/
+void tmap_add(tmap_t *m, long from, long to){
+	long d, p[TMAP_DEPTH], min=LONG_MAX;
+
+	if (!m->width){
+		row_add(&m->row[from], to, 1);
+		return;
+	}
+	for (d=0; d<TMAP_DEPTH; d++){
+		p[d]=sketch_pos(m, d, from, to);
+		if (m->sketch[p[d]]<min)
+			min=m->sketch[p[d]];
+	}
+	for (d=0; d<TMAP_DEPTH; d++)
+		if (m->sketch[p[d]]==min)
+			m->sketch[p[d]]++;
+}
+
+/**
+* Gets the packets sent from a source to each destination.
+*
+* @param m The map.
+* @param from The source.
+* @param row The counters of each destination, for nprocs destinations.
+*/
+void tmap_row(tmap_t *m, long from, long *row){
+	tmap_row_t *r;
+	long d, j, s, c;
+
+	if (m->width){
+		for (j=0; j<nprocs; j++){
+			row[j]=LONG_MAX;
+			for (d=0; d<TMAP_DEPTH; d++)
+				if ((c=m->sketch[sketch_pos(m, d, from, j)]) < row[j])
+					row[j]=c;
+		}
+		return;
+	}
+	for (j=0; j<nprocs; j++)
+		row[j]=0;
+	r=&m->row[from];
+	for (s=0; s<r->size; s++)
+		if (r->slot[s].dst!=-1)
+			row[r->slot[s].dst]=r->slot[s].count;
+}
+
+/**
+* Gets the destinations a source has sent packets to, and the packets sent to each one.
+*
+* Only the pairs in use are visited in the exact map; the sketch is expanded row by row.
+*
+* @param m The map.
+* @param from The source.
+* @param dst The destinations, for up to nprocs destinations.
+* @param count The packets sent to each destination.
+* @return The number of destinations.
+*/
+long tmap_pairs(tmap_t *m, long from, long *dst, long *count){
+	tmap_row_t *r;
+	long j, s, n=0;
+
+	if (m->width){
+		tmap_row(m, from, count);
+		for (j=0; j<nprocs; j++)
+			if (count[j]){
+				dst[n]=j;
+				count[n++]=count[j];
+			}
+		return n;
+	}
+	r=&m->row[from];
+	for (s=0; s<r->size; s++)
+		if (r->slot[s].dst!=-1 && r->slot[s].count){
+			dst[n]=r->slot[s].dst;
+			count[n++]=r->slot[s].count;
+		}
+	return n;
+}
+
+/**
+* Saves or restores a map in a checkpoint.
+*
+* Only the pairs in use are saved, and they are inserted again when restoring.
+*
+* @param m The map.
+*/
+void tmap_checkpoint(tmap_t *m){
+	tmap_row_t *r;
+	long i, s, n, width=m->width;
+	tmap_slot_t sl;
+
+	CKPT(width);
+	if (width!=m->width)
+		panic("The checkpoint does not match the configuration of this simulation");
+	if (m->width){
+		ckpt_data(m->sketch, TMAP_DEPTH*m->width*sizeof(long));
+		return;
+	}
+	if (!ckpt_saving())
+		tmap_reset(m);
+	for (i=0; i<nprocs; i++){
+		r=&m->row[i];
+		n=r->used;
+		CKPT(n);
+		if (ckpt_saving()){
+			for (s=0; s<r->size; s++)
+				if (r->slot[s].dst!=-1)
+					CKPT(r->slot[s]);
+		}
+		else
+			for (s=0; s<n; s++){
+				CKPT(sl);
+				if (sl.dst<0 || sl.dst>=nprocs)
+					panic("Error in the checkpoint file");
+				row_add(r, sl.dst, sl.count);
+			}
+	}
+}
@@ -0,0 +1,57 @@
+/**
+* @file
+* @brief	Definition of the maps of sources & destinations.
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef _tmap
+#define _tmap
+
+#define TMAP_DEPTH 4	///< Hash functions (rows of counters) of the count-min sketch.
+
+/**
+* A destination and its counter in the hash table of a source.
+*/
+typedef struct tmap_slot_t {
+	long dst;		///< The destination, -1 when the slot is empty.
+	long count;		///< Packets from the source to the destination.
+} tmap_slot_t;
+
+/**
+* Hash table (open addressing, linear probing) with the destinations of a source.
+*/
+typedef struct tmap_row_t {
+	long size;			///< Slots in the table, a power of two (0 until the first packet).
+	long used;			///< Slots in use.
+	tmap_slot_t *slot;	///< The slots.
+} tmap_row_t;
+
+/**
+* A map of the packets between each pair of nodes.
+*
+* Only the pairs which have exchanged packets take memory: each source keeps a hash table of
+* its destinations. When a width is given the map is approximated by a count-min sketch of
+* #TMAP_DEPTH x width counters instead, so its size does not depend on the traffic; the counts
+* are never lower than the exact ones.
+*/
+typedef struct tmap_t {
+	tmap_row_t *row;	///< The hash table of each source (exact map).
+	long width;			///< Counters in each row of the sketch, 0 for the exact map.
+	long *sketch;		///< The counters of the sketch (approximate map).
+} tmap_t;
+
+#endif /* _tmap */
@@ -31,14 +31,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #if (TRACE_SUPPORT != 0)
 
-#define FILE_TIME 73		///< Default delay for accessing a file.
-#define FILE_SCALE 3		///< Default scale for file accesses based on the size.
-#define op_per_cycle 50		///< balances the computation time (cpu time/op_per_cycle)==fsin cycles.
-#define cpuspeed  1e6		///< The cpu speed in Mhz.
 #define BUFSIZE 131072		///< The size of the buffer,
 
-#define CPU_SCALE 2
-
 void read_dimemas();
 void read_fsin_trc();
 void read_alog();
@@ -54,29 +48,199 @@ void icube_placement();
 void circulant_placement();
 void file_placement();
 
+static void init_trc_tracking();
+static double replay_factor(long r);
+static void run_trace();
+
 long **translation;	///< A matrix containing the simulation nodes for each trace task.
 
+long trc_pending=0;	///< Number of nodes with events still to occur.
+long trc_receiving=0;	///< Number of nodes whose head event is a reception.
+long trc_computing=0;	///< Number of nodes whose head event is a computation.
+
+static long *cpu_heap;	///< Binary min-heap with the computing nodes, ordered by their #cpu_end.
+static long *heap_pos;	///< Position of each node in #cpu_heap, or -1 if it is not computing.
+static long heap_size=0;	///< Number of nodes in #cpu_heap.
+
+static double cpu_factor=1.0;	///< Factor applied to the cpu bursts in the current replay of the trace.
+static long replay=0;			///< The replay of the trace being run.
+
+static event_q *shared_events=NULL;	///< The events of each node read before forking the workers of a sweep, or NULL.
+static source_t *shared_source=NULL;	///< The source type of each node after placing the tasks of #shared_events.
+static char shared_rng[sizeof(rng_state)];	///< The state of rand() after reading #shared_events.
+
 /**
-* The trace reader dispatcher selects the format type and calls to the correct trace read.
+* A loop being read from a fsin trc file.
+*/
+typedef struct trc_loop {
+	long iters;	///< Number of iterations.
+	long *body;	///< The body of the loop in each node (in #loop_body), or -1 if the node has no events in it.
+} trc_loop;
+
+static trc_loop loop_stack[MAX_LOOP_DEPTH];	///< The loops being read, the innermost at the top.
+static long loop_depth=0;	///< Number of loops being read.
+static event_q *loop_body=NULL;	///< The bodies of the loops of all the nodes.
+static long n_loops=0;		///< Number of loop bodies.
+static long max_loops=0;	///< Room for loop bodies in #loop_body.
+
+/**
+* A thread of a task which is not being performed in its node. Its events wait in their own queue
+* until the thread is switched in.
 *
-* The selection reads the first character in the file. This could be: '#' for dimemas,
-* 'c', 's' or 'r' for fsin trc, and '-' for alog (in complete trace the header is "-1",
-* or in filtered trace could be "-101" / "-102"). This is a very naive decision, so we
-* probably have to change this, but for the moment it works.
+* @see schedule_threads
+*/
+typedef struct trc_thread {
+	long id;			///< The thread id in the trace.
+	event_q events;		///< The events of the thread.
+	CLOCK_TYPE cpu_end;	///< Cycle in which its head computation finishes, or -1 if it has not started.
+} trc_thread;
+
+static trc_thread **threads=NULL;	///< The threads switched out in each node.
+static long *n_threads=NULL;		///< Number of threads in #threads of each node.
+static long *thread_id=NULL;		///< The thread whose events are in the queue of each node, or -1 if none.
+static long read_thread=0;			///< The thread of the trace record being read.
+static CLOCK_TYPE resume_end=-1;	///< End of the computation of the thread being switched in, or -1.
+
+/**
+* Gets the event queue of a thread of a node, for the record being read (thread #read_thread).
 *
-*@see read_dimemas
-*@see read_fsin_trc
-*@see read_alog
+* The first thread of each node uses the queue of the node, the rest are added to #threads.
+*
+* @param i The node.
+* @return The queue of the thread.
+*/
+static event_q *thread_queue(long i){
+	long k;
+
+	if (thread_id==NULL){
+		thread_id=alloc(nprocs*sizeof(long));
+		n_threads=alloc(nprocs*sizeof(long));
+		threads=alloc(nprocs*sizeof(trc_thread *));
+		for (k=0; k<nprocs; k++){
+			thread_id[k]=-1;
+			n_threads[k]=0;
+			threads[k]=NULL;
+		}
+	}
+	if (thread_id[i]<0)
+		thread_id[i]=read_thread;
+	if (thread_id[i]==read_thread)
+		return &network[i].events;
+	for (k=0; k<n_threads[i]; k++)
+		if (threads[i][k].id==read_thread)
+			return &threads[i][k].events;
+	if ((threads[i]=realloc(threads[i], (k+1)*sizeof(trc_thread)))==NULL)
+		panic("Not enough memory for the trace threads");
+	threads[i][k].id=read_thread;
+	threads[i][k].cpu_end=-1;
+	init_event(&threads[i][k].events);
+	n_threads[i]++;
+	return &threads[i][k].events;
+}
+
+/**
+* Reads the workload of the simulation: the trace (or the kernel) or the jobs.
+*
+* The tasks are placed, their events are read and the tracking of the nodes is initialized.
+*
+* @see place_tasks
+* @see read_trace_file
+* @see read_jobs
+* @see read_job_log
 */
 void read_trace(){
-	FILE * ftrc;
-	char c;
+	long i, k;
+
+	init_protocol();
+	if (jobfile[0]!='\0')
+		read_jobs();
+	else if (joblog[0]!='\0')	// Jobs are read as they are started.
+		read_job_log();
+	else if (shared_events!=NULL){	// Read by the sweep before forking this worker.
+		for (i=0; i<nprocs; i++){
+			network[i].events=shared_events[i];
+			network[i].source=shared_source[i];
+		}
+		if (placement==RANDOM_PLACE || placement==OPT_PLACE){	// They use rand() or the routing, which may be random.
+			setstate(shared_rng);
+			memcpy(rng_state, shared_rng, sizeof(rng_state));
+			setstate(rng_state);
+		}
+	}
+	else {
+		translation=malloc(trace_nodes*sizeof(long *));
+		for (i=0; i<trace_nodes; i++)
+			translation[i]=malloc(trace_instances*sizeof(long));
+		if (placement==OPT_PLACE)	// The trace is read to place the tasks.
+			optimized_placement();
+		else {
+			place_tasks();
+			if (kernel!=NO_KERNEL)	// Events are generated as the simulation goes on.
+				init_kernel();
+			else
+				read_trace_file();
+		}
+	}
+	if (analytic>0){
+		analytic_prepass();
+		if (analytic>1)	// Only the pre-pass is wanted.
+			exit(0);
+	}
+	if (n_cpu_ratios>1 && kernel==NO_KERNEL)	// The trace is replayed several times.
+		for (i=0; i<nprocs; i++){
+			keep_events(&network[i].events);
+			for (k=0; n_threads!=NULL && k<n_threads[i]; k++)
+				keep_events(&threads[i][k].events);
+		}
+	init_paraver();
+	init_critical();
+	init_noise();
+	init_trc_tracking();
+}
+
+/**
+* Places the tasks & reads the events of the trace before a sweep forks its workers.
+*
+* The network is built with the configuration of the command line, so the tasks can be placed,
+* and the events read are kept for the workers, which get a copy of them when forked and take
+* them in read_trace() instead of reading the trace file again. The placements which use rand()
+* also give them its state after placing the tasks, so the results are the same. Only for a single
+* trace file, when the sweep does not change how the trace is read.
+*
+* @see trace_option
+*/
+void share_trace(){
 	long i;
 
+	initstate((unsigned)r_seed, rng_state, sizeof(rng_state));	// As in simulate().
+	router_init();
+	init_functions();
+	init_network();
+	for (i=0; i<nprocs; i++)
+		network[i].source=INDEPENDENT_SOURCE;
 	translation=malloc(trace_nodes*sizeof(long *));
 	for (i=0; i<trace_nodes; i++)
 		translation[i]=malloc(trace_instances*sizeof(long));
+	if (placement==OPT_PLACE)
+		optimized_placement();
+	else {
+		place_tasks();
+		read_trace_file();
+	}
+	shared_events=alloc(nprocs*sizeof(event_q));
+	shared_source=alloc(nprocs*sizeof(source_t));
+	for (i=0; i<nprocs; i++){
+		shared_events[i]=network[i].events;
+		shared_source[i]=network[i].source;
+	}
+	setstate(rng_state);	// Stores the position of the generator in its state.
+	memcpy(shared_rng, rng_state, sizeof(shared_rng));
+}
 
+/**
+* Places the tasks of the trace in the nodes (in #translation) using the configured strategy.
+*/
+void place_tasks(){
 	switch (placement){
 		case CONSECUTIVE_PLACE:
 		case ROW_PLACE:
@@ -109,10 +273,30 @@ void read_trace(){
 		case FILE_PLACE:
 			file_placement();
 			break;
+		case OPT_PLACE:
+			panic("Optimized placement is only available for a single trace file");
+			break;
 		default:
 			panic("Undefined placement strategy");
 			break;
 	}
+}
+
+/**
+* The trace reader dispatcher selects the format type and calls to the correct trace read.
+*
+* The selection reads the first character in the file. This could be: '#' for dimemas,
+* 'c', 's', 'r' or 'l' for fsin trc, and '-' for alog (in complete trace the header is "-1",
+* or in filtered trace could be "-101" / "-102"). This is a very naive decision, so we
+* probably have to change this, but for the moment it works.
+*
+*@see read_dimemas
+*@see read_fsin_trc
+*@see read_alog
+*/
+void read_trace_file(){
+	FILE * ftrc;
+	char c;
 
 	if((ftrc = fopen(trcfile, "r")) == NULL){
 		printf("%s\n",trcfile);
@@ -131,6 +315,7 @@ void read_trace(){
 		case 'c':
 		case 's':
 		case 'r':
+		case 'l':
 			read_fsin_trc();
 			break;
 		case -1:
@@ -142,12 +327,414 @@ void read_trace(){
 	}
 }
 
+static long **coll_bytes;	///< Bytes sent by each task in each of its collectives.
+static long *coll_n;		///< Number of collectives of each task.
+static long *coll_seq;		///< Number of collectives of each task already expanded.
+
+/**
+* Reads the bytes sent by every task in each of its collectives.
+*
+* The size of the messages in the expanded collectives depends on the sending task, so
+* all of them have to be known before expanding any collective.
+*
+* @param ftrc The dimemas trace file, just after the header.
+* @param n The number of tasks in the trace.
+*/
+static void read_coll_sizes(FILE *ftrc, long n){
+	char buffer[BUFSIZE];
+	long t, bytes, *max;
+
+	coll_bytes=alloc(n*sizeof(long *));
+	coll_n=alloc(n*sizeof(long));
+	coll_seq=alloc(n*sizeof(long));
+	max=alloc(n*sizeof(long));
+	for (t=0; t<n; t++){
+		coll_n[t]=coll_seq[t]=0;
+		max[t]=16;
+		coll_bytes[t]=alloc(max[t]*sizeof(long));
+	}
+	while(fgets(buffer, BUFSIZE, ftrc) != NULL) {
+		if (sscanf(buffer, "10:%ld:%*[^:]:%*[^:]:%*[^:]:%*[^:]:%*[^:]:%ld", &t, &bytes)!=2 || t<0 || t>=n)
+			continue;
+		if (coll_n[t]==max[t]){
+			max[t]*=2;
+			if ((coll_bytes[t]=realloc(coll_bytes[t], max[t]*sizeof(long)))==NULL)
+				panic("Unable to allocate memory for the collectives");
+		}
+		coll_bytes[t][coll_n[t]++]=bytes;
+	}
+	free(max);
+}
+
+/**
+* Frees the sizes of the collectives.
+*
+* @param n The number of tasks in the trace.
+*/
+static void free_coll_sizes(long n){
+	long t;
+
+	for (t=0; t<n; t++)
+		free(coll_bytes[t]);
+	free(coll_bytes);
+	free(coll_n);
+	free(coll_seq);
+}
+
+/**
+* Gets the bytes sent by a task in a collective.
+*
+* @param t The task.
+* @param k The collective (its position among all the collectives of the task).
+* @return The number of bytes sent by the task.
+*/
+static long coll_size(long t, long k){
+	if (k>=coll_n[t])
+		panic("Collectives do not match among the tasks in the trace");
+	return coll_bytes[t][k];
+}
+
+/**
+* Inserts a point-to-point event of an expanded collective in all the instances of a task.
+*
+* @param type SENDING or RECEPTION.
+* @param task The task performing the event.
+* @param other The task receiving (sending) the message.
+* @param bytes The size of the message.
+* @param tag The tag of the message, unique for each collective.
+*/
+static void coll_event(event_t type, long task, long other, long bytes, long tag){
+	event ev;
+	long inst;
+
+	ev.type=type;
+	ev.task=tag;
+	ev.count=0;
+	ev.length=bytes;
+	if (ev.length <= 0)
+		ev.length=1;
+	ev.length = (long)ceil ( (double)ev.length/(pkt_len*phit_len));
+	for (inst=0; inst<trace_instances; inst++){
+		ev.pid=translation[other][inst];
+		ins_event(thread_queue(translation[task][inst]), ev);
+	}
+}
+
+#define coll_send(r, d, b) coll_event(SENDING, (r), (d), (b), tag)		///< Sends a message of a collective.
+#define coll_recv(r, s, b) coll_event(RECEPTION, (r), (s), (b), tag)	///< Receives a message of a collective.
+#define REAL(v) (((v)+root)%P)	///< The task with relative rank v (relative to the root).
+
+/**
+* Sums the bytes sent by a group of consecutive tasks (relative to the root).
+*/
+static long coll_sum(long from, long to, long root, long P, long k){
+	long v, sum=0;
+
+	for (v=from; v<to && v<P; v++)
+		sum+=coll_size(REAL(v), k);
+	return sum;
+}
+
+/**
+* Broadcast (or scatter) using a binomial tree.
+*
+* @param r The task.
+* @param root The root of the tree.
+* @param P The number of tasks.
+* @param bytes The size of the message (of each block if it is a scatter).
+* @param scatter Whether each child receives the blocks of its whole subtree.
+* @param tag The tag of the messages.
+*/
+static void bcast_binomial(long r, long root, long P, long bytes, bool_t scatter, long tag){
+	long vr=(r-root+P)%P, mask=1;
+
+	while (mask<P){
+		if (vr & mask){
+			coll_recv(r, REAL(vr-mask), (scatter)? bytes*min(mask, P-vr) : bytes);
+			break;
+		}
+		mask<<=1;
+	}
+	for (mask>>=1; mask>0; mask>>=1)
+		if (vr+mask<P)
+			coll_send(r, REAL(vr+mask), (scatter)? bytes*min(mask, P-vr-mask) : bytes);
+}
+
+/**
+* Reduction (or gather) using a binomial tree.
+*
+* @param r The task.
+* @param root The root of the tree.
+* @param P The number of tasks.
+* @param k The collective of the tasks.
+* @param gather Whether each task sends the blocks of its whole subtree.
+* @param tag The tag of the messages.
+*/
+static void reduce_binomial(long r, long root, long P, long k, bool_t gather, long tag){
+	long vr=(r-root+P)%P, mask=1;
+
+	while (mask<P){
+		if (vr & mask){
+			coll_send(r, REAL(vr-mask), (gather)? coll_sum(vr, vr+mask, root, P, k) : coll_size(r, k));
+			break;
+		}
+		if (vr+mask<P)
+			coll_recv(r, REAL(vr+mask), (gather)? coll_sum(vr+mask, vr+2*mask, root, P, k) : coll_size(REAL(vr+mask), k));
+		mask<<=1;
+	}
+}
+
+/**
+* Broadcast (or scatter) along a chain starting in the root.
+*
+* @see bcast_binomial
+*/
+static void bcast_chain(long r, long root, long P, long bytes, bool_t scatter, long tag){
+	long vr=(r-root+P)%P;
+
+	if (vr>0)
+		coll_recv(r, REAL(vr-1), (scatter)? bytes*(P-vr) : bytes);
+	if (vr<P-1)
+		coll_send(r, REAL(vr+1), (scatter)? bytes*(P-vr-1) : bytes);
+}
+
+/**
+* Reduction (or gather) along a chain finishing in the root.
+*
+* @see reduce_binomial
+*/
+static void reduce_chain(long r, long root, long P, long k, bool_t gather, long tag){
+	long vr=(r-root+P)%P;
+
+	if (vr<P-1)
+		coll_recv(r, REAL(vr+1), (gather)? coll_sum(vr+1, P, root, P, k) : coll_size(REAL(vr+1), k));
+	if (vr>0)
+		coll_send(r, REAL(vr-1), (gather)? coll_sum(vr, P, root, P, k) : coll_size(r, k));
+}
+
+/**
+* Allreduce using recursive doubling. Tasks beyond the largest power of two are
+* folded into the lower ones before, and get the result after, the exchanges.
+*/
+static void allreduce_rdoubling(long r, long P, long k, long tag){
+	long p2=1, mask;
+
+	while (2*p2<=P)
+		p2*=2;
+	if (r>=p2){
+		coll_send(r, r-p2, coll_size(r, k));
+		coll_recv(r, r-p2, coll_size(r-p2, k));
+		return;
+	}
+	if (r<P-p2)
+		coll_recv(r, r+p2, coll_size(r+p2, k));
+	for (mask=1; mask<p2; mask<<=1){
+		coll_send(r, r^mask, coll_size(r, k));
+		coll_recv(r, r^mask, coll_size(r^mask, k));
+	}
+	if (r<P-p2)
+		coll_send(r, r+p2, coll_size(r, k));
+}
+
+/**
+* Reduce-scatter in a ring: each task sends 1/P of its data to the next one in each step.
+*
+* @param steps The number of steps: P-1 for a reduce-scatter, 2(P-1) for an allreduce.
+*/
+static void ring_steps(long r, long P, long k, long steps, long tag){
+	long s;
+
+	for (s=0; s<steps; s++){
+		coll_send(r, (r+1)%P, coll_size(r, k)/P);
+		coll_recv(r, (r-1+P)%P, coll_size((r-1+P)%P, k)/P);
+	}
+}
+
+/**
+* Exchange with every other task, one in each step.
+*
+* @param fraction The part of the data sent to each task (1 for allgather, P for alltoall).
+*/
+static void pairwise_steps(long r, long P, long k, long fraction, long tag){
+	long s;
+
+	for (s=1; s<P; s++){
+		coll_send(r, (r+s)%P, coll_size(r, k)/fraction);
+		coll_recv(r, (r-s+P)%P, coll_size((r-s+P)%P, k)/fraction);
+	}
+}
+
+/**
+* Allgather in a ring: in each step, each task forwards the last block it has received.
+*/
+static void allgather_ring(long r, long P, long k, long tag){
+	long s;
+
+	for (s=0; s<P-1; s++){
+		coll_send(r, (r+1)%P, coll_size((r-s+P)%P, k));
+		coll_recv(r, (r-1+P)%P, coll_size((r-1-s+2*P)%P, k));
+	}
+}
+
+/**
+* Allgather using recursive doubling (only for a power of two number of tasks).
+*/
+static void allgather_rdoubling(long r, long P, long k, long tag){
+	long mask, root=0;
+
+	for (mask=1; mask<P; mask<<=1){
+		coll_send(r, r^mask, coll_sum(r & ~(mask-1), (r & ~(mask-1))+mask, root, P, k));
+		coll_recv(r, r^mask, coll_sum((r^mask) & ~(mask-1), ((r^mask) & ~(mask-1))+mask, root, P, k));
+	}
+}
+
+/**
+* Barrier by dissemination: in each step, a task notifies the one 2^step positions ahead.
+*/
+static void barrier_dissemination(long r, long P, long tag){
+	long mask;
+
+	for (mask=1; mask<P; mask<<=1){
+		coll_send(r, (r+mask)%P, 0);
+		coll_recv(r, (r-mask+P)%P, 0);
+	}
+}
+
+/**
+* Scan. In a chain or by recursive doubling.
+*/
+static void scan(long r, long P, long k, bool_t doubling, long tag){
+	long mask;
+
+	if (!doubling){
+		if (r>0)
+			coll_recv(r, r-1, coll_size(r-1, k));
+		if (r<P-1)
+			coll_send(r, r+1, coll_size(r, k));
+		return;
+	}
+	for (mask=1; mask<P; mask<<=1){
+		if (r+mask<P)
+			coll_send(r, r+mask, coll_size(r, k));
+		if (r-mask>=0)
+			coll_recv(r, r-mask, coll_size(r-mask, k));
+	}
+}
+
+/**
+* Expands the part of a task in a collective into point-to-point events.
+*
+* The algorithm is selected with #coll_alg. When the selected algorithm does not suit a
+* collective, a binomial tree (rooted collectives) or a pairwise exchange (all-to-all
+* operations) is used instead. All the tasks in the trace form the communicator. The size
+* of each message is obtained from the data sent by the sending task in the collective.
+* Within each step the sending is done before the reception, so no task waits for another
+* one that is waiting for it.
+*
+* @param op The collective operation.
+* @param r The task.
+* @param root The root task of the collective.
+* @param P The number of tasks in the trace.
+*/
+static void expand_collective(long op, long r, long root, long P){
+	long k=coll_seq[r]++;
+	long tag=-(k+1);	// Negative tags are not used by point-to-point messages.
+	bool_t p2=((P & (P-1))==0);
+
+	if (r>=P)
+		panic("Collective in an undefined task");
+	if (P<2)
+		return;
+	if (root<0 || root>=P)
+		root=0;
+
+	switch (op){
+	case OP_MPI_Barrier:
+		if (coll_alg==BINOMIAL_COLL){
+			reduce_binomial(r, 0, P, k, B_FALSE, tag);
+			bcast_binomial(r, 0, P, 0, B_FALSE, tag);
+		} else if (coll_alg==RING_COLL){
+			reduce_chain(r, 0, P, k, B_FALSE, tag);
+			bcast_chain(r, 0, P, 0, B_FALSE, tag);
+		} else
+			barrier_dissemination(r, P, tag);
+		break;
+	case OP_MPI_Bcast:
+	case OP_MPI_Scatter:
+	case OP_MPI_Scatterv:
+		if (op==OP_MPI_Bcast){
+			if (coll_alg==RING_COLL)
+				bcast_chain(r, root, P, coll_size(root, k), B_FALSE, tag);
+			else
+				bcast_binomial(r, root, P, coll_size(root, k), B_FALSE, tag);
+		} else {
+			if (coll_alg==RING_COLL)
+				bcast_chain(r, root, P, coll_size(root, k)/P, B_TRUE, tag);
+			else
+				bcast_binomial(r, root, P, coll_size(root, k)/P, B_TRUE, tag);
+		}
+		break;
+	case OP_MPI_Gather:
+	case OP_MPI_Gatherv:
+	case OP_MPI_Reduce:
+		if (coll_alg==RING_COLL)
+			reduce_chain(r, root, P, k, (op!=OP_MPI_Reduce), tag);
+		else
+			reduce_binomial(r, root, P, k, (op!=OP_MPI_Reduce), tag);
+		break;
+	case OP_MPI_Allreduce:
+		if (coll_alg==BINOMIAL_COLL){
+			reduce_binomial(r, 0, P, k, B_FALSE, tag);
+			bcast_binomial(r, 0, P, coll_size(0, k), B_FALSE, tag);
+		} else if (coll_alg==RING_COLL)
+			ring_steps(r, P, k, 2*(P-1), tag);
+		else
+			allreduce_rdoubling(r, P, k, tag);
+		break;
+	case OP_MPI_Allgather:
+	case OP_MPI_Allgatherv:
+		if (coll_alg==BINOMIAL_COLL){
+			reduce_binomial(r, 0, P, k, B_TRUE, tag);
+			bcast_binomial(r, 0, P, coll_sum(0, P, 0, P, k), B_FALSE, tag);
+		} else if (coll_alg==RING_COLL || (coll_alg==RDOUBLING_COLL && !p2))
+			allgather_ring(r, P, k, tag);
+		else if (coll_alg==RDOUBLING_COLL)
+			allgather_rdoubling(r, P, k, tag);
+		else
+			pairwise_steps(r, P, k, 1, tag);
+		break;
+	case OP_MPI_Alltoall:
+	case OP_MPI_Alltoallv:
+		pairwise_steps(r, P, k, P, tag);
+		break;
+	case OP_MPI_Reduce_Scatter:
+		if (coll_alg==BINOMIAL_COLL){
+			reduce_binomial(r, 0, P, k, B_FALSE, tag);
+			bcast_binomial(r, 0, P, coll_size(0, k)/P, B_TRUE, tag);
+		} else if (coll_alg==RING_COLL)
+			ring_steps(r, P, k, P-1, tag);
+		else
+			pairwise_steps(r, P, k, P, tag);
+		break;
+	case OP_MPI_Scan:
+		scan(r, P, k, (coll_alg==RDOUBLING_COLL || coll_alg==PAIRWISE_COLL), tag);
+		break;
+	}
+}
+#undef REAL
+
 /**
 * Reads a trace from a dimemas file.
 *
 * Read a trace from a dimemas file whose name is in global variable #trcfile
-* It only consideres events for CPU and point to point operations. File I/O could be
+* It only consideres events for CPU, point to point operations and, if #coll_alg is not
+* none, collectives (expanded into point to point operations). File I/O could be
 * considered as a cpu event if FILEIO is defined.
+* Each thread of a task gets its own event queue, and the threads of a node are performed
+* concurrently, sharing its injection & consumption ports.
+*
+* @see expand_collective
+* @see schedule_threads
 */
 void read_dimemas() {
 	FILE * ftrc;
@@ -191,6 +778,12 @@ void read_dimemas() {
 	if (n>trace_nodes)
 		panic("There are not enough nodes for running this trace");
 
+	if (coll_alg!=NO_COLL){
+		long pos=ftell(ftrc);
+		read_coll_sizes(ftrc, n);
+		fseek(ftrc, pos, SEEK_SET);
+	}
+
 	while(fgets(buffer, BUFSIZE, ftrc) != NULL) {
 		op_id=strtok( buffer, sep);
 		if (!strcmp(op_id,"s")) // Offset
@@ -219,17 +812,18 @@ void read_dimemas() {
 		if ( task_id>n || task_id <0 )
 			panic ("Task id not defined: Aborting");
 		th_id=atol(strtok( NULL, sep)); //We have the thread id.
+		read_thread=th_id;
 		switch (atol(op_id)){
 		case CPU:
 			cpu_burst=atof(strtok( NULL, sep)); //We have the time taken by the CPU.
 			ev.type=COMPUTATION;
-			ev.length=(long)ceil((cpu_burst*cpuspeed)/op_per_cycle); // Computation time.
+			ev.length=(long)ceil((cpu_burst*cpu_speed)/op_per_cycle); // Computation time.
 			if (ev.length>0){
                 ev.count=0;	// Elapsed time.
                 if (task_id<trace_nodes && task_id>=0)
                     for (inst=0; inst<trace_instances; inst++){
                         ev.pid=translation[task_id][inst];
-                        ins_event(&network[ev.pid].events, ev); // Add event to its node event queue
+                        ins_event(thread_queue(ev.pid), ev); // Add event to its thread event queue
                     }
                 else
                     panic("Adding cpu event into a non defined CPU");
@@ -249,7 +843,7 @@ void read_dimemas() {
 			case RENDEZVOUS: // This should be Ssend (synchronized)
 			case IMMEDIATE:  // This should be Isend (inmediate)
 			case BOTH:       // This should be Issend(inmediate & synchronized)
-				ev.type=SENDING;
+				ev.type=rdv_send_type(size, (type==RENDEZVOUS || type==BOTH), (type==NONE || type==RENDEZVOUS));
 				if (task_id !=t_id) { // Valid event
 					ev.task=tag; // Type of message
 					ev.length=size; // Length of message
@@ -261,7 +855,7 @@ void read_dimemas() {
 						for (inst=0; inst<trace_instances; inst++){
 							i=translation[task_id][inst]; // Node to add event
 							ev.pid=translation[t_id][inst]; // event's PID: destination when we are sending
-							ins_event(&network[i].events, ev); // Add event to its node event queue
+							ins_event(thread_queue(i), ev); // Add event to its thread event queue
 						}
 					else
 						panic("Adding comm event into a non defined CPU");
@@ -282,12 +876,13 @@ void read_dimemas() {
 			comm=atol(strtok( NULL, sep)); //We have the communicator id.
 			type=atol(strtok( NULL, sep)); //We have the recv type (Recv, Irecv or Wait).
 			switch (type){
-			case IRECV: // This is not useful for us.
-				break;
+			case IRECV: // Only useful to post receptions for the rendezvous protocol.
+				if (eager_threshold<0 || size<=eager_threshold)
+					break;
 			// A reception and a wait is the same for us.
 			case RECV:
 			case WAIT:
-				ev.type=RECEPTION;
+				ev.type=(type==IRECV)? IRECEPTION : RECEPTION;
 				if (t_id!=task_id) {// Valid event
 					ev.task=tag; // Type of message
 					ev.length=size; // Length of message
@@ -299,7 +894,7 @@ void read_dimemas() {
 						for (inst=0; inst<trace_instances; inst++){
 							i=translation[task_id][inst]; // Node to add event
 							ev.pid=translation[t_id][inst]; // event's PID: destination when we are sending
-							ins_event(&network[i].events, ev); // Add event to its node event queue
+							ins_event(thread_queue(i), ev); // Add event to its thread event queue
 						}
 					else
 						panic("Adding comm event into a non defined CPU");
@@ -320,32 +915,21 @@ void read_dimemas() {
 			brecv=atol(strtok( NULL, sep));    //We have the received byte count.
 			switch (type){
 			case OP_MPI_Barrier:
-				break;
 			case OP_MPI_Bcast:
-				break;
 			case OP_MPI_Gather:
-				break;
 			case OP_MPI_Gatherv:
-				break;
 			case OP_MPI_Scatter:
-				break;
 			case OP_MPI_Scatterv:
-				break;
 			case OP_MPI_Allgather:
-				break;
 			case OP_MPI_Allgatherv:
-				break;
 			case OP_MPI_Alltoall:
-				break;
 			case OP_MPI_Alltoallv:
-				break;
 			case OP_MPI_Reduce:
-				break;
 			case OP_MPI_Allreduce:
-				break;
 			case OP_MPI_Reduce_Scatter:
-				break;
 			case OP_MPI_Scan:
+				if (coll_alg!=NO_COLL)
+					expand_collective(type, task_id, rtask_id, n);
 				break;
 			default:
 				printf("WARNING: There is an Unexpected Collective type!!!\n");
@@ -365,13 +949,13 @@ void read_dimemas() {
 			strtok( NULL, sep);       // Required size is dropped here.
 			cpu_burst=atol(strtok( NULL, sep));   //We have the size.
 			ev.type=COMPUTATION;
-			ev.length=(long)ceil((FILE_TIME+(FILE_SCALE*cpu_burst)/op_per_cycle)); // Computation time.
+			ev.length=(long)ceil((file_time+(file_scale*cpu_burst)/op_per_cycle)); // Computation time.
 			if (ev.length>0){
                 ev.count=0;				// Elapsed time.
                 if (task_id<trace_nodes && task_id>=0)
                     for (inst=0; inst<trace_instances; inst++){
                         ev.pid=translation[task_id][inst];
-                        ins_event(&network[ev.pid].events, ev); // Add event to its node event queue
+                        ins_event(thread_queue(ev.pid), ev); // Add event to its thread event queue
                     }
                 else
                     panic("Adding cpu event into a non defined CPU");
@@ -386,13 +970,13 @@ void read_dimemas() {
 		case FUNLINK:
 #ifdef FILEIO
 			ev.type=COMPUTATION;
-			ev.length=(long)ceil((FILE_TIME)/op_per_cycle); // Computation time.
+			ev.length=(long)ceil((file_time)/op_per_cycle); // Computation time.
 			if (ev.length>0){
                 ev.count=0; // Elapsed time.
                 if (task_id<trace_nodes && task_id>=0)
                     for (inst=0; inst<trace_instances; inst++){
                         ev.pid=translation[task_id][inst];
-                        ins_event(&network[ev.pid].events, ev); // Add event to its node event queue
+                        ins_event(thread_queue(ev.pid), ev); // Add event to its thread event queue
                     }
                 else
                     panic("Adding cpu event into a non defined CPU");
@@ -460,6 +1044,178 @@ void read_dimemas() {
 		}
 	}
 	fclose(ftrc);
+	read_thread=0;
+	if (coll_alg!=NO_COLL)
+		free_coll_sizes(n);
+}
+
+/**
+* Adds an event read from a fsin trc file to a node: to its queue, or to the body of the
+* innermost loop being read.
+*
+* @param i The node.
+* @param ev The event.
+*/
+static void trc_insert(long i, event ev){
+	trc_loop *l;
+
+	if (loop_depth==0){
+		ins_event(&network[i].events, ev);
+		return;
+	}
+	l=&loop_stack[loop_depth-1];
+	if (l->body[i]<0){
+		if (n_loops==max_loops){
+			max_loops=2*max_loops+16;
+			if ((loop_body=realloc(loop_body, max_loops*sizeof(event_q)))==NULL)
+				panic("Not enough memory for the trace loops");
+		}
+		init_event(&loop_body[n_loops]);
+		l->body[i]=n_loops++;
+	}
+	ins_event(&loop_body[l->body[i]], ev);
+}
+
+/**
+* Opens a loop in a fsin trc file.
+*
+* @param iters The number of iterations.
+*/
+static void trc_loop_open(long iters){
+	long i;
+
+	if (loop_depth==MAX_LOOP_DEPTH)
+		panic("Too many nested loops in the trace");
+	loop_stack[loop_depth].iters=iters;
+	loop_stack[loop_depth].body=alloc(nprocs*sizeof(long));
+	for (i=0; i<nprocs; i++)
+		loop_stack[loop_depth].body[i]=-1;
+	loop_depth++;
+}
+
+/**
+* Closes the innermost loop in a fsin trc file.
+*
+* Each node with events in the loop gets a LOOP event, which is expanded when it reaches
+* the head of the node queue.
+*/
+static void trc_loop_close(){
+	trc_loop *l;
+	event ev;
+	long i;
+
+	if (loop_depth==0)
+		panic("Closing a loop which has not been opened in the trace");
+	l=&loop_stack[--loop_depth];
+	ev.type=LOOP;
+	ev.pid=0;
+	ev.length=l->iters;
+	ev.count=0;
+	for (i=0; i<nprocs; i++)
+		if (l->body[i]>=0 && l->iters>0){
+			ev.task=l->body[i];
+			trc_insert(i, ev);
+		}
+	free(l->body);
+}
+
+/**
+* Expands the loops in the head of the queue of a node.
+*
+* The body of the loop is copied before it, until the last iteration, in which it is removed.
+*
+* @param i The node.
+*/
+static void expand_loops(long i){
+	event ev;
+
+	while (!event_empty(&network[i].events) && head_event(&network[i].events).type==LOOP){
+		do_event(&network[i].events, &ev);
+		push_events(&network[i].events, &loop_body[ev.task]);
+	}
+}
+
+/**
+* Adds the data sent in a list of events to the communication volumes of the placement optimizer.
+*
+* @param i The node of the events.
+* @param n The first event.
+* @param mult The number of times the events are repeated (iterations of the enclosing loops).
+*/
+static void sent_volume(long i, event_n *n, double mult){
+	for (; n!=NULL; n=n->next)
+		switch (n->ev.type){
+			case SENDING:
+			case RDV_SENDING:
+			case RDV_ISENDING:
+				place_volume(i, n->ev.pid, mult*n->ev.length*pkt_len*phit_len);
+				break;
+			case LOOP:
+				sent_volume(i, loop_body[n->ev.task].head, mult*n->ev.length);
+				break;
+			default:
+				break;
+		}
+}
+
+/**
+* Adds the data sent by a node in the trace to the communication volumes of the placement optimizer.
+*
+* @param i The node.
+*/
+void trc_volume(long i){
+	long k;
+
+	sent_volume(i, network[i].events.head, 1.0);
+	for (k=0; n_threads!=NULL && k<n_threads[i]; k++)
+		sent_volume(i, threads[i][k].events.head, 1.0);
+}
+
+/**
+* Gets the number of event streams (threads) of a node.
+*
+* @param i The node.
+*/
+long trc_streams(long i){
+	return 1+((n_threads!=NULL)? n_threads[i] : 0);
+}
+
+/**
+* Gets the first event of a stream of a node.
+*
+* @param i The node.
+* @param k The stream: 0 is the queue of the node, the rest are its switched out threads.
+*/
+event_n * trc_stream(long i, long k){
+	return (k==0)? network[i].events.head : threads[i][k-1].events.head;
+}
+
+/**
+* Gets the first event of the body of a loop.
+*
+* @param l The loop body, as given in the LOOP events.
+*/
+event_n * trc_loop_body(long l){
+	return loop_body[l].head;
+}
+
+/**
+* Removes all the events (and loops) read from the trace, so it can be read again.
+*/
+void clear_trace(){
+	long i, k;
+
+	for (i=0; i<nprocs; i++){
+		while (!event_empty(&network[i].events))
+			rem_head_event(&network[i].events);
+		for (k=0; n_threads!=NULL && k<n_threads[i]; k++)
+			while (!event_empty(&threads[i][k].events))
+				rem_head_event(&threads[i][k].events);
+	}
+	for (i=0; i<n_loops; i++)
+		while (!event_empty(&loop_body[i]))
+			rem_head_event(&loop_body[i]);
+	n_loops=0;
 }
 
 /**
@@ -467,6 +1223,8 @@ void read_dimemas() {
 *
 * Read a trace from a fsin trc file whose name is in global variable #trcfile
 * This format only takes in account 'c' CPU, 's' SEND, 'r' RECV, events.
+* The lines between 'l' iterations and 'e' are repeated that number of iterations. Loops can be nested and
+* are not expanded when reading, but when their events are reached during the simulation.
 */
 void read_fsin_trc() {
 	FILE * ftrc;
@@ -508,6 +1266,8 @@ void read_fsin_trc() {
 					ev.task=atol(tok); // Type of message (tag)
 					tok=strtok(NULL, sep);
 					ev.length=atol(tok); // Length of message
+					if (ev.type==SENDING)
+						ev.type=rdv_send_type(ev.length, B_FALSE, B_FALSE); // Not known whether blocking, so it must not block.
 					ev.count=0; // Packets sent or received
 					if (ev.length == 0)
 						ev.length=1;
@@ -516,7 +1276,7 @@ void read_fsin_trc() {
 						for (inst=0; inst<trace_instances; inst++){
 							i=translation[n1][inst]; // Node to add event
 							ev.pid=translation[n2][inst]; // event's PID: destination when we are sending
-							ins_event(&network[i].events, ev); // Add event to its node event queue
+							trc_insert(i, ev); // Add event to its node event queue
 						}
 					else
 						panic("Adding comm event into a non defined CPU");
@@ -550,15 +1310,25 @@ void read_fsin_trc() {
                     if (n1<trace_nodes && n1>=0)
                         for (inst=0; inst<trace_instances; inst++){
                             ev.pid=translation[n1][inst]; // Node to add event
-                            ins_event(&network[ev.pid].events, ev); // Add event to its node event queue
+                            trc_insert(ev.pid, ev); // Add event to its node event queue
                         }
                     else
                         panic("Adding cpu event into a non defined CPU");
                 }
 			}
+
+			else if (strcmp(tok, "l")==0){ // Loop.
+				tok=strtok(NULL, sep);
+				trc_loop_open(atol(tok)); // Iterations.
+			}
+
+			else if (strcmp(tok, "e")==0) // End of loop.
+				trc_loop_close();
 		}
 	}
 	fclose(ftrc);
+	if (loop_depth>0)
+		panic("Unclosed loop in the trace");
 }
 
 /**
@@ -904,40 +1674,326 @@ void file_placement() {
 	}
 }
 
+/**
+* Swaps two positions of the cpu heap, keeping #heap_pos up to date.
+*/
+static void heap_swap(long a, long b){
+	long t=cpu_heap[a];
+
+	cpu_heap[a]=cpu_heap[b];
+	cpu_heap[b]=t;
+	heap_pos[cpu_heap[a]]=a;
+	heap_pos[cpu_heap[b]]=b;
+}
+
+/**
+* Moves up an element of the cpu heap until its parent finishes before it.
+*/
+static void heap_up(long p){
+	while (p>0 && network[cpu_heap[(p-1)/2]].cpu_end > network[cpu_heap[p]].cpu_end){
+		heap_swap(p, (p-1)/2);
+		p=(p-1)/2;
+	}
+}
+
+/**
+* Moves down an element of the cpu heap until its children finish after it.
+*/
+static void heap_down(long p){
+	long c;
+
+	while ((c=2*p+1)<heap_size){
+		if (c+1<heap_size && network[cpu_heap[c+1]].cpu_end < network[cpu_heap[c]].cpu_end)
+			c++;
+		if (network[cpu_heap[p]].cpu_end <= network[cpu_heap[c]].cpu_end)
+			break;
+		heap_swap(p, c);
+		p=c;
+	}
+}
+
+/**
+* Inserts a node in the cpu heap. Its #cpu_end must be already set.
+*/
+static void heap_push(long i){
+	cpu_heap[heap_size]=i;
+	heap_pos[i]=heap_size++;
+	heap_up(heap_pos[i]);
+}
+
+/**
+* Removes a node from any position of the cpu heap.
+*/
+static void heap_remove(long i){
+	long p=heap_pos[i];
+
+	heap_pos[i]=-1;
+	if (p==--heap_size)
+		return;
+	cpu_heap[p]=cpu_heap[heap_size];
+	heap_pos[cpu_heap[p]]=p;
+	heap_up(p);
+	heap_down(heap_pos[cpu_heap[p]]);
+}
+
+/**
+* Gets how soon the head of a thread can be performed.
+*
+* @param i The node.
+* @param q The events of the thread.
+* @param head The head event of the thread.
+* @param cpu_end The end of its computation, or -1 if it has not started.
+* @param parked Whether the thread is switched out. Then its reception can be performed to reply an RTS.
+* @return 0 if it can be performed now (or its computation has not started or has finished),
+* the end of its computation, CLOCK_MAX-1 if it waits a message or CLOCK_MAX if it has finished.
+*/
+static CLOCK_TYPE thread_wait(long i, event_q *q, event_t head, CLOCK_TYPE cpu_end, bool_t parked){
+	switch (head){
+		case NO_EVENT:
+			return CLOCK_MAX;
+		case COMPUTATION:
+			return (cpu_end<=sim_clock)? 0 : cpu_end;
+		case RECEPTION:
+			if (has_occurred(&network[i].occurs, head_event(q)) || (parked && rdv_rts_arrived(i, head_event(q))))
+				return 0;
+			return CLOCK_MAX-1;
+		default:
+			return 0;
+	}
+}
+
+/**
+* Switches the thread performed in a node for another one. The head of the node must be set after.
+*
+* @param i The node.
+* @param k The thread to switch in (in #threads).
+*/
+static void switch_thread(long i, long k){
+	trc_thread *t=&threads[i][k];
+	event_q q=network[i].events;
+	long id=thread_id[i];
+
+	network[i].events=t->events;
+	thread_id[i]=t->id;
+	resume_end=t->cpu_end;
+	t->events=q;
+	t->id=id;
+	t->cpu_end=(network[i].head==COMPUTATION && !event_empty(&q))? network[i].cpu_end : -1;
+}
+
+/**
+* Updates the tracking information of a node whose head event may have changed.
+*
+* Keeps the number of pending, receiving and computing nodes, so the end of the
+* simulation and the deadlocks can be detected without scanning all the nodes, and
+* the heap of computing nodes. Computations are not done cycle by cycle: the cycle in
+* which they finish is annotated in #cpu_end and they are removed when it is reached.
+*
+* @param i The node whose head has changed.
+* @param start The first cycle the new head event can be performed.
+*/
+static void trc_set_head(long i, CLOCK_TYPE start){
+	event e;
+	event_t head;
+	long k;
+
+	crit_head(i, network[i].head);
+	expand_loops(i);
+	if (event_empty(&network[i].events) && n_threads!=NULL)	// This thread has finished, another one goes on.
+		for (k=0; k<n_threads[i]; k++)
+			if (!event_empty(&threads[i][k].events)){
+				switch_thread(i, k);
+				expand_loops(i);
+				break;
+			}
+	if (event_empty(&network[i].events) && !kernel_next(i))
+		head=NO_EVENT;
+	else {
+		e=head_event(&network[i].events);
+		head=e.type;
+	}
+
+	switch (network[i].head){
+		case RECEPTION:
+			trc_receiving--;
+			break;
+		case COMPUTATION:
+			trc_computing--;
+			heap_remove(i);
+			break;
+		default:
+			break;
+	}
+	if (network[i].head!=NO_EVENT)
+		trc_pending--;
+
+	switch (head){
+		case RECEPTION:
+			trc_receiving++;
+			break;
+		case COMPUTATION:
+			trc_computing++;
+			if (resume_end>=0)	// A thread switched in goes on with its computation.
+				network[i].cpu_end=resume_end;
+			else
+				network[i].cpu_end=start+cpu_noise(i, start, (CLOCK_TYPE)ceil((e.length-e.count)*cpu_factor))-1;
+			heap_push(i);
+			break;
+		default:
+			break;
+	}
+	if (head!=NO_EVENT){
+		trc_pending++;
+		rdv_new_head(i, e);
+	}
+	if ((head==NO_EVENT) != (network[i].head==NO_EVENT))
+		job_node_active(i, head!=NO_EVENT);
+	network[i].head=head;
+	resume_end=-1;
+}
+
+/**
+* Switches the threads of a node, so the one performed is the first one able to go on.
+*
+* The threads of a node share its ports, and all of them are performed concurrently: the one in the
+* queue of the node is the one sending or receiving, while the rest are computing or waiting for
+* messages. When this one has to wait, it is switched out for a thread which can be performed, or
+* for the computing thread finishing first (so the end of its computation is tracked). The computations
+* go on while switched out. A thread waiting for a rendezvous sent is not switched out, as it must keep
+* its handshake.
+*
+* @param i The node.
+* @param start The first cycle the new head event can be performed.
+*/
+static void schedule_threads(long i, CLOCK_TYPE start){
+	CLOCK_TYPE w, cur, best;
+	trc_thread *t;
+	long k, b;
+
+	if (n_threads==NULL || n_threads[i]==0)
+		return;
+	while (network[i].head!=RDV_SENDING &&
+			(cur=thread_wait(i, &network[i].events, network[i].head, network[i].cpu_end, B_FALSE))>0){
+		best=cur;
+		b=-1;
+		for (k=0; k<n_threads[i]; k++){
+			t=&threads[i][k];
+			if (event_empty(&t->events))
+				continue;
+			w=(head_event(&t->events).type==COMPUTATION && t->cpu_end<0)? 0 :
+				thread_wait(i, &t->events, head_event(&t->events).type, t->cpu_end, B_TRUE);
+			if (w<best){
+				best=w;
+				b=k;
+			}
+		}
+		if (b<0)
+			return;
+		switch_thread(i, b);
+		trc_set_head(i, start);
+	}
+}
+
+/**
+* Switches the threads of a node if the one being performed has to wait.
+*
+* Must be called when a node is visited, as the messages waited by its other threads may have arrived.
+*
+* @param i The node.
+*/
+void trc_schedule(long i){
+	schedule_threads(i, sim_clock);
+}
+
+/**
+* Updates the tracking information of a node after removing its head event.
+*
+* Must be called every time the head of a node event queue is removed during the
+* simulation. The new head could be performed from the next cycle on.
+*
+* @param i The node whose head has changed.
+*/
+void trc_head_changed(long i){
+	trc_set_head(i, sim_clock+1);
+	schedule_threads(i, sim_clock+1);
+}
+
+/**
+* Gets the factor applied to the cpu bursts in a replay of the trace.
+*
+* @param r The number of the replay.
+* @return The cpu scale divided by the CPU/network speed ratio of the replay.
+*/
+static double replay_factor(long r){
+	return cpu_scale/((n_cpu_ratios>0)? cpu_ratios[r] : 1.0);
+}
+
+/**
+* Initializes the tracking of the nodes heads once the trace has been read.
+*/
+static void init_trc_tracking(){
+	long i;
+
+	cpu_factor=replay_factor(0);
+	cpu_heap=alloc(nprocs*sizeof(long));
+	heap_pos=alloc(nprocs*sizeof(long));
+	for (i=0; i<nprocs; i++){
+		heap_pos[i]=-1;
+		trc_set_head(i, sim_clock);
+		schedule_threads(i, sim_clock);
+	}
+}
+
+/**
+* Activates the nodes in a subtree of the cpu heap whose cpu bursts have finished.
+*/
+static void finished_cpus_from(long p){
+	if (p>=heap_size || network[cpu_heap[p]].cpu_end>sim_clock)
+		return;
+#if (ACTIVE_NODES!=0)
+	activate_node(cpu_heap[p]);
+#endif
+	finished_cpus_from(2*p+1);
+	finished_cpus_from(2*p+2);
+}
+
+/**
+* Activates all the nodes whose cpu bursts finish in this cycle (or earlier), so they are visited.
+*
+* Only the heap branches with finished bursts are explored.
+*/
+void trc_finished_cpus(){
+	finished_cpus_from(0);
+}
+
 #if (SKIP_CPU_BURSTS==1)
 /**
 * Looks for the next CPU to finish and skips as many cycles as necessary (if network load is 0). Should speed up the execution of CPU-biased applications)
+*
+* The computing nodes are kept in a heap, so the next one to finish is found in constant time.
+* When only the active nodes are visited, cycles are skipped as soon as there are no active nodes.
+* A node stays active while its pcount, which includes the phits in its injection queues, is not
+* zero, so no cycles are skipped while some packet is in the network or waiting to be injected.
 */
 void next_cpu_to_finish(){
-    long i;
-    CLOCK_TYPE res=CLOCK_MAX;
-    event e;
+    CLOCK_TYPE res;
 
-    if (injected_count - rcvd_count != 0)
+    if (heap_size==0)
+        return;
+#if (ACTIVE_NODES!=0)
+    if (active_nodes()>0) // Some node has phits, is sending or has received a message.
+        return;
+    if (active_nodes()<0)
+#endif
+    if (injected_count - rcvd_count != 0 || trc_pending - trc_receiving - trc_computing > 0 || rdv_outstanding > 0) // Some node is sending.
         return;
 
-    for (i=0; i<NUMNODES; i++) {
-        if (network[i].source!=INDEPENDENT_SOURCE && !event_empty(&network[i].events)){
-            e=head_event(&network[i].events);
-            if (e.type==COMPUTATION){
-                //printf("%ld, %"PRINT_CLOCK"\n",i,e.length-e.count);
-                if (e.length-e.count<res)
-                    res=e.length-e.count;
-            } else if (e.type==SENDING)
-                return;
-        }
-    }
-    if (res!=CLOCK_MAX){
+    res=min(network[cpu_heap[0]].cpu_end, next_job_arrival())-sim_clock;	// Do not skip the arrival of a job.
+    if (ckpt_file[0]!='\0' && ckpt_period>0)	// Nor a checkpoint.
+        res=min(res, ckpt_period-1-sim_clock%ckpt_period);
+    if (res>0){
         printf("%11"PRINT_CLOCK":: Skipped %"PRINT_CLOCK" cycles due to CPU-only activity\n",sim_clock,res);
-        sim_clock+=res; // current cycles hasn't been counted yet.
-
-        for (i=0; i<NUMNODES; i++) {
-            if (network[i].source!=INDEPENDENT_SOURCE && !event_empty(&network[i].events)){
-                e=head_event(&network[i].events);
-                if (e.type==COMPUTATION)
-                    do_event_n_times (&network[i].events, &e, res);
-            }
-        }
+        sim_clock+=res; // Computations are removed when their cpu_end is reached.
     }
 }
 #endif //SKIP_CPU_BURSTS
@@ -971,37 +2027,95 @@ void report_receiving_tasks(){
 
 /**
 * Checks whether a trace execution has reached to a deadlock state, i.e. all tasks waiting for others
+* (receiving or waiting for a clear to send) and no pending control packets or non-blocking sents.
 *
 *@return B_FALSE if any active task which is not in RECV state, B_TRUE otherwise
 */
 bool_t deadlocked_trc(){
-    long i;
-    event e;
-
-    for (i=0; i<NUMNODES; i++) {
-        if (network[i].source!=INDEPENDENT_SOURCE && !event_empty(&network[i].events) && (e=head_event(&network[i].events)).type!=RECEPTION)
-            return B_FALSE;
-    }
-    return B_TRUE;
+    if (trc_pending==0)	// Nothing running, i.e. waiting for the next job.
+        return B_FALSE;
+    return (trc_receiving+rdv_waiting==trc_pending && rdv_outstanding==0);
 }
 
 long deadlocked_period=0;
 #endif /* CHECK_TRC_DEADLOCK */
 
+/**
+* Prepares the trace to be replayed with another CPU/network speed ratio.
+*
+* The event queues (or the kernels) are rewound instead of reading the trace again. The packets still in
+* the network (i.e. background traffic) are delivered before, out of the measured time.
+*
+* @param r The number of the replay.
+*/
+static void rewind_trace(long r){
+	long i, k;
+
+	while (!pkt_all_free() && !interrupted && !aborted){
+		data_movement(B_FALSE);
+		sim_clock++;
+	}
+	last_reset_time=sim_clock;
+	cpu_factor=replay_factor(r);
+	if (kernel!=NO_KERNEL)
+		rewind_kernel();
+	rewind_jobs();
+	init_critical();
+	init_noise();
+	for (i=0; i<nprocs; i++){
+		if (kernel==NO_KERNEL)
+			rewind_events(&network[i].events);
+		for (k=0; n_threads!=NULL && k<n_threads[i]; k++){
+			rewind_events(&threads[i][k].events);
+			threads[i][k].cpu_end=-1;
+		}
+		trc_set_head(i, sim_clock);
+		schedule_threads(i, sim_clock);
+#if (ACTIVE_NODES!=0)
+		activate_node(i);
+#endif
+	}
+}
+
 /**
 * Runs simulation using a trace file as workload.
 *
 * In this mode, simulation are running until all the events in the nodes queues are done.
 * It prints partial results each pinterval simulation cycles & calculates global
 * queues states for global congestion control.
+* When several CPU/network speed ratios are given, the trace is replayed once for each
+* of them, and the results of each replay are stored as a separate sample.
 *
 * @see read_trace()
 * @see init_functions
 * @see run_network
 */
 void run_network_trc() {
-		long i;
+	long first=replay;	// Not 0 when restored from a checkpoint of a later replay.
+
+#if (ACTIVE_NODES!=0)
+	init_active_nodes();
+#endif
+	for (replay=first; replay<samples && !interrupted && !aborted; replay++){
+		if (replay>first)
+			rewind_trace(replay);
+		run_trace();
+		if (n_cpu_ratios>1)
+			printf("CPU/network speed ratio %g: %"PRINT_CLOCK" cycles\n", cpu_ratios[replay], sim_clock-last_reset_time);
+		print_critical();
+		print_partials();
+		save_batch_results();
+		reset_stats();
+	}
+	close_paraver();
+}
+
+/**
+* Runs one replay of the trace, until all the events have been done.
+*/
+static void run_trace() {
 	do {
+		schedule_jobs();
 #if (CHECK_TRC_DEADLOCK>0)
 		if (deadlocked_trc()){
             if(deadlocked_period++>CHECK_TRC_DEADLOCK){
@@ -1024,17 +2138,55 @@ void run_network_trc() {
 			global_q_u = global_q_u_current;
 			global_q_u_current = injected_count - rcvd_count;
 		}
-		go_on=B_FALSE;
-		for (i=0; i<NUMNODES; i++) {
-			if (!event_empty (&network[i].events) /*&& network[i].source==OTHER_SOURCE*/) {
-				go_on=B_TRUE;
-				break;
-			}
-		}
+		go_on=(trc_pending>0 || rdv_outstanding>0 || jobs_waiting());
+		if (go_on)	// A finished replay is not restored, the next one starts from scratch.
+			checkpoint_cycle();
 	} while (go_on && !interrupted  && !aborted);
-	print_partials();
-	save_batch_results();
-	reset_stats();
+}
+
+/**
+* Saves or restores the state of the replay of the trace in a checkpoint.
+*
+* The event queues of the nodes & their threads, their occurred events, the tracking of their heads
+* and the state of the protocol, the noise & the kernel. The trace is read again when restoring, so
+* the loop bodies are the same, and its events are replaced by the saved ones.
+*/
+void trc_checkpoint(){
+	long i, k;
+
+	CKPT(replay);
+	CKPT(trc_pending);
+	CKPT(trc_receiving);
+	CKPT(trc_computing);
+	CKPT(heap_size);
+	ckpt_data(cpu_heap, nprocs*sizeof(long));
+	ckpt_data(heap_pos, nprocs*sizeof(long));
+#if (CHECK_TRC_DEADLOCK>0)
+	CKPT(deadlocked_period);
+#endif
+	for (i=0; i<nprocs; i++){
+		CKPT(network[i].head);
+		CKPT(network[i].cpu_end);
+		event_checkpoint(&network[i].events);
+#if (TRACE_SUPPORT > 1)
+		for (k=0; k<nprocs; k++)
+			occur_checkpoint(&network[i].occurs[k]);
+#else
+		occur_checkpoint(&network[i].occurs);
+#endif
+		if (n_threads==NULL)
+			continue;
+		CKPT(thread_id[i]);
+		for (k=0; k<n_threads[i]; k++){
+			CKPT(threads[i][k].id);
+			CKPT(threads[i][k].cpu_end);
+			event_checkpoint(&threads[i][k].events);
+		}
+	}
+	cpu_factor=replay_factor(replay);
+	rdv_checkpoint();
+	noise_checkpoint();
+	kernel_checkpoint();
 }
 #endif
 
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Timing check of the placement optimizer with 10000 tasks in a 100x100 torus.
+# Each task talks to its 2D stencil neighbours and to a random task, and the tasks are numbered
+# in a shuffled order, so the consecutive placement is poor. Only the placement is done (analytic=2).
+#
+# Usage: place_10k.sh [fsin binary] [seconds]
+# Fails if the optimizer does not finish within the given seconds (default 15; the old exhaustive
+# greedy mapping took 17s on the reference machine, the candidate search takes 8s).
+
+FSIN=${1:-fsin}
+LIMIT=${2:-15}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+awk 'BEGIN {
+	N=100; T=N*N; srand(5);
+	for (i=0; i<T; i++) task[i]=i;
+	for (i=T-1; i>0; i--) { j=int(rand()*(i+1)); x=task[i]; task[i]=task[j]; task[j]=x }
+	for (i=0; i<T; i++) printf "c %d 1000\n", i;
+	for (i=0; i<T; i++) {
+		x=int(i/N); y=i%N; t=task[i];
+		dst[0]=task[((x+1)%N)*N+y]; dst[1]=task[x*N+(y+1)%N]; dst[2]=int(rand()*T);
+		for (k=0; k<3; k++)
+			if (dst[k]!=t) printf "s %d %d 0 4096\nr %d %d 0 4096\n", t, dst[k], t, dst[k];
+	}
+}' > "$DIR/stencil.trc"
+
+cd "$DIR" || exit 1
+START=$(date +%s)
+timeout -s KILL "$LIMIT" "$FSIN" topo=torus_100_100 tpattern=trace tracefile=stencil.trc placement=optimized_stencil.map_10000 \
+	analytic=2 pheaders=0 plevel=0 output=place | grep "Placement optimizer" || { echo "FAILED: placement not done in ${LIMIT}s"; exit 1; }
+echo "Placement of 10000 tasks in $(( $(date +%s) - START ))s"
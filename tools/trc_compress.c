@@ -0,0 +1,203 @@
+/**
+* @file
+* @brief	Loop compressor for fsin trc files.
+*
+* Looks for blocks of consecutive lines which are repeated several times in a row and
+* replaces them by a loop:
+*
+*     l iterations
+*     ... block ...
+*     e
+*
+* The blocks are compressed recursively, so nested loops are found as well. Only identical
+* lines are considered equal, so traces with noisy computation times should be rounded before.
+*
+* Usage: trc_compress [-k max_block] input.trc > output.trc
+* Build: cc -O2 -o trc_compress trc_compress.c
+
+FSIN Functional Simulator of Interconnection Networks
+Copyright (2003-2011) J. Miguel-Alonso, J. Navaridas
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFSIZE 512		///< Maximum length of a line.
+
+static char **text=NULL;	///< The different lines in the trace.
+static long n_text=0;		///< Number of different lines.
+static long *hash_tab=NULL;	///< Hash table with the position of each line in #text, or -1.
+static long hash_size=0;	///< Size of #hash_tab.
+
+static long *lines=NULL;	///< The trace, as the id (in #text) of each of its lines.
+static long n_lines=0;		///< Number of lines in the trace.
+
+static long max_block=4096;	///< Longest block looked for.
+static long out_lines=0;	///< Number of lines written.
+
+/**
+* Prints an error and exits.
+*/
+static void fail(char *mes){
+	fprintf(stderr, "trc_compress: %s\n", mes);
+	exit(1);
+}
+
+/**
+* Allocates memory, exiting if it is not possible.
+*/
+static void * xrealloc(void *p, long size){
+	if ((p=realloc(p, size))==NULL)
+		fail("Not enough memory");
+	return p;
+}
+
+/**
+* Hash function for the lines (djb2).
+*/
+static unsigned long hash(char *s){
+	unsigned long h=5381;
+
+	while (*s)
+		h=h*33+(unsigned char)*s++;
+	return h;
+}
+
+/**
+* Gets the id of a line, adding it to #text if it is new.
+*
+* @param s The line, already normalized.
+* @return The id of the line.
+*/
+static long intern(char *s){
+	long i, p;
+
+	if (2*n_text>=hash_size){	// Grow & rehash.
+		hash_size=(hash_size)? 2*hash_size : 1024;
+		hash_tab=xrealloc(hash_tab, hash_size*sizeof(long));
+		for (i=0; i<hash_size; i++)
+			hash_tab[i]=-1;
+		for (i=0; i<n_text; i++){
+			for (p=hash(text[i])%hash_size; hash_tab[p]>=0; p=(p+1)%hash_size)
+				;
+			hash_tab[p]=i;
+		}
+	}
+	for (p=hash(s)%hash_size; hash_tab[p]>=0; p=(p+1)%hash_size)
+		if (!strcmp(text[hash_tab[p]], s))
+			return hash_tab[p];
+	text=xrealloc(text, (n_text+1)*sizeof(char*));
+	text[n_text]=strdup(s);
+	hash_tab[p]=n_text;
+	return n_text++;
+}
+
+/**
+* Reads a fsin trc file, normalizing the spacing of its lines.
+*
+* Comments and empty lines are dropped. Loops are not accepted: the input must be uncompressed.
+*/
+static void read_trc(FILE *f){
+	char buffer[BUFSIZE], norm[BUFSIZE], *tok;
+	char sep[]=" \t\r\n";
+	long max_lines=0;
+
+	while (fgets(buffer, BUFSIZE, f)!=NULL){
+		if (buffer[0]=='\n' || buffer[0]=='#')
+			continue;
+		norm[0]='\0';
+		for (tok=strtok(buffer, sep); tok!=NULL; tok=strtok(NULL, sep)){
+			if (norm[0]!='\0')
+				strcat(norm, " ");
+			strcat(norm, tok);
+		}
+		if (norm[0]=='\0')
+			continue;
+		if ((norm[0]=='l' || norm[0]=='e') && (norm[1]==' ' || norm[1]=='\0'))
+			fail("The trace already has loops");
+		if (n_lines==max_lines){
+			max_lines=(max_lines)? 2*max_lines : 4096;
+			lines=xrealloc(lines, max_lines*sizeof(long));
+		}
+		lines[n_lines++]=intern(norm);
+	}
+}
+
+/**
+* Writes a block of lines, compressing its repetitions.
+*
+* At each position, the block length which saves more lines is chosen. The repeated block
+* is compressed again, so inner loops are found.
+*
+* @param l The lines.
+* @param n The number of lines.
+*/
+static void compress(long *l, long n){
+	long p=0, k, r, gain, best_k, best_r, best_gain;
+
+	while (p<n){
+		best_k=0;
+		best_r=1;
+		best_gain=0;
+		for (k=1; k<=max_block && p+2*k<=n; k++){
+			if (l[p+k]!=l[p])
+				continue;
+			for (r=1; p+(r+1)*k<=n && !memcmp(l+p, l+p+r*k, k*sizeof(long)); r++)
+				;
+			gain=(r-1)*k-2;	// Lines saved, minus the loop ones.
+			if (gain>best_gain){
+				best_k=k;
+				best_r=r;
+				best_gain=gain;
+			}
+		}
+		if (best_gain>0){
+			printf("l %ld\n", best_r);
+			compress(l+p, best_k);
+			printf("e\n");
+			out_lines+=2;
+			p+=best_k*best_r;
+		}
+		else {
+			printf("%s\n", text[l[p++]]);
+			out_lines++;
+		}
+	}
+}
+
+/**
+* Main function: reads the trace & writes it compressed to the standard output.
+*/
+int main(int argc, char *argv[]){
+	FILE *f;
+	int a=1;
+
+	if (argc>2 && !strcmp(argv[1], "-k")){
+		max_block=atol(argv[2]);
+		a=3;
+	}
+	if (a!=argc-1 || max_block<1){
+		fprintf(stderr, "Usage: %s [-k max_block] input.trc > output.trc\n", argv[0]);
+		return 1;
+	}
+	if ((f=fopen(argv[a], "r"))==NULL)
+		fail("Cannot open the trace file");
+	read_trc(f);
+	fclose(f);
+	compress(lines, n_lines);
+	fprintf(stderr, "%ld lines compressed into %ld lines\n", n_lines, out_lines);
+	return 0;
+}